@@ -0,0 +1,19 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <stddef.h>
+
+// Alocador por regiao: blocos grandes servidos sequencialmente e liberados
+// todos de uma vez. Usado para a AST, que vive do parse ate o fim da execucao.
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    size_t used;      // bytes entregues (estatistica)
+    size_t reserved;  // bytes alocados em blocos
+} Arena;
+
+void *arena_alloc(Arena *a, size_t size);
+char *arena_strndup(Arena *a, const char *s, size_t len);
+void arena_release(Arena *a);
+
+#endif
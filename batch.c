@@ -0,0 +1,157 @@
+#include "batch.h"
+#include "pool.h"
+#include "macslang.h"
+#include "source.h"
+#include "interpreter.h"
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Um script do lote; o Task vem primeiro para o trabalhador recuperar o Job.
+typedef struct {
+    Task task;
+    const char *path;
+    char *out;          // saida capturada ou mensagem de erro
+    size_t len;
+    int failed;
+    double latency;     // segundos entre comecar a carga e terminar
+    atomic_int done;
+} Job;
+
+static int quicken;     // --no-quicken vale para todos os trabalhadores
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void set_text(Job *job, const char *text, size_t len) {
+    job->out = malloc(len + 1);
+    memcpy(job->out, text, len);
+    job->out[len] = '\0';
+    job->len = len;
+}
+
+static void run_job(Task *task) {
+    Job *job = (Job*)task;
+    double t0 = now_seconds();
+    quicken_enabled = quicken;
+    // Os scripts ja dividem os trabalhadores: parallel for roda em sequencia.
+    parallel_threads = 1;
+    Source source;
+    if (source_open_file(&source, job->path) != 0) {
+        char msg[4096];
+        int n = snprintf(msg, sizeof(msg), "Could not open file: %s\n", job->path);
+        set_text(job, msg, n < (int)sizeof(msg) ? (size_t)n : sizeof(msg) - 1);
+        job->failed = 1;
+    } else {
+        // Pipes e fifos chegam em blocos: le tudo antes da carga.
+        if (!source.map_len)
+            while (source_refill(&source, 0) > 0);
+        MacsContext *ctx = macs_new();
+        macs_set_output(ctx, MACS_CAPTURE);
+        if (macs_load(ctx, source.data, (int)source.len) != 0) {
+            const char *err = macs_error(ctx);
+            set_text(job, err, strlen(err));
+            job->failed = 1;
+        } else {
+            int len;
+            const char *text = macs_output(ctx, &len);
+            set_text(job, text, (size_t)len);
+        }
+        macs_free(ctx);
+        source_close(&source);
+    }
+    job->latency = now_seconds() - t0;
+    atomic_store_explicit(&job->done, 1, memory_order_release);
+}
+
+int batch_read_manifest(const char *manifest, char ***paths) {
+    FILE *f = fopen(manifest, "r");
+    if (!f) return -1;
+    int count = 0, cap = 0;
+    char **list = NULL;
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t n;
+    while ((n = getline(&line, &line_cap, f)) >= 0) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+        if (n == 0) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            list = realloc(list, sizeof(char*) * cap);
+        }
+        list[count++] = strdup(line);
+    }
+    free(line);
+    fclose(f);
+    *paths = list;
+    return count;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Percentil pelo posto mais proximo sobre `sorted`.
+static double percentile(const double *sorted, int n, int p) {
+    int rank = (int)(((long)p * n + 99) / 100);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+static void report(Job *jobs, int count, int threads, int failed, double elapsed) {
+    fprintf(stderr, "batch: %d scripts (%d failed) in %.3f s on %d threads: %.1f scripts/s\n",
+            count, failed, elapsed, threads, elapsed > 0 ? count / elapsed : 0.0);
+    if (count == 0) return;
+    double *lat = malloc(sizeof(double) * count);
+    for (int i = 0; i < count; i++) lat[i] = jobs[i].latency * 1e3;
+    qsort(lat, count, sizeof(double), cmp_double);
+    fprintf(stderr, "latency: p50 %.3f ms  p90 %.3f ms  p99 %.3f ms  max %.3f ms\n",
+            percentile(lat, count, 50), percentile(lat, count, 90), percentile(lat, count, 99), lat[count - 1]);
+    free(lat);
+}
+
+int batch_run(char **paths, int count, int jobs, FILE *out) {
+    if (jobs < 1) jobs = pool_cpu_count();
+    quicken = quicken_enabled;
+    Job *list = calloc(count + 1, sizeof(Job));
+    double t0 = now_seconds();
+    Pool *pool = pool_new(jobs);
+    // Todos tiram do topo da deque (os ladroes e, com pool_help_oldest, esta
+    // thread): os scripts comecam na ordem de entrada, a saida em ordem
+    // raramente espera e pouca saida fica retida em memoria.
+    for (int i = 0; i < count; i++) {
+        list[i].task.run = run_job;
+        list[i].path = paths[i];
+        atomic_init(&list[i].done, 0);
+        pool_push(pool, &list[i].task);
+    }
+
+    // Esta thread tambem executa scripts e, entre um e outro, escreve as
+    // saidas ja prontas na ordem de entrada.
+    int next = 0, failed = 0;
+    while (next < count) {
+        Job *job = &list[next];
+        if (atomic_load_explicit(&job->done, memory_order_acquire)) {
+            fwrite(job->out, 1, job->len, out);
+            free(job->out);
+            job->out = NULL;
+            failed += job->failed;
+            next++;
+            continue;
+        }
+        if (!pool_help_oldest(pool)) sched_yield();
+    }
+    fflush(out);
+    double elapsed = now_seconds() - t0;
+    pool_free(pool);
+
+    report(list, count, jobs, failed, elapsed);
+    free(list);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <stdio.h>
+
+// Execucao em lote (--jobs N): muitos scripts num so processo, distribuidos
+// entre N trabalhadores de um pool com roubo de trabalho (pool.h). Cada
+// script roda no seu proprio MacsContext, sem estado compartilhado, e a sua
+// saida e capturada em memoria; as saidas sao escritas em `out` na ordem de
+// entrada, assim que cada script e os anteriores terminam. Erros de analise
+// aparecem no lugar da saida do script, como na execucao isolada. No fim,
+// vazao e percentis de latencia vao para stderr.
+
+// Le os caminhos de `manifest`, um por linha (linhas vazias sao ignoradas);
+// devolve o numero lido e o vetor em *paths (malloc), ou -1.
+int batch_read_manifest(const char *manifest, char ***paths);
+// Devolve 0 se todos os scripts carregaram.
+int batch_run(char **paths, int count, int jobs, FILE *out);
+
+#endif
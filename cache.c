@@ -0,0 +1,530 @@
+#include "cache.h"
+#include "symtab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Layout do arquivo: cabecalho, imagem da AST e nomes dos simbolos. A imagem
+// guarda os nos com o mesmo layout da memoria; cada ponteiro vira
+// deslocamento + 1 dentro da imagem (0 continua NULL). Os ids de simbolos
+// ficam como estao: ao carregar, os nomes sao internados na mesma ordem numa
+// tabela ainda vazia, o que reproduz os ids. Os nomes vem logo apos a imagem,
+// ate o fim do arquivo.
+typedef struct {
+    char magic[8];
+    uint64_t key;           // hash do fonte + versao + opcoes
+    uint64_t check;         // hash da imagem e dos nomes
+    uint64_t source_len;
+    uint64_t image_offset, image_len;
+    uint64_t syms_offset;
+    uint32_t sym_count;     // simbolos alem dos predefinidos
+    uint32_t root;          // referencia da raiz na imagem
+} CacheHeader;
+
+static const char cache_magic[8] = "MACSLC\0";
+
+static uint64_t fnv64(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+// Hash de conferencia do conteudo; encadeavel por `h`. Quatro acumuladores
+// independentes de 8 bytes, para as multiplicacoes nao esperarem umas pelas
+// outras: a imagem inteira e lida a cada carga.
+static uint64_t content_hash(uint64_t h, const char *p, size_t len) {
+    uint64_t lane[4] = { h ^ len, h + 1, h + 2, h + 3 };
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        for (int k = 0; k < 4; k++) {
+            uint64_t w;
+            memcpy(&w, p + i + 8 * k, sizeof(w));
+            lane[k] = (lane[k] ^ w) * 0x9E3779B97F4A7C15ull;
+            lane[k] ^= lane[k] >> 29;
+        }
+    }
+    for (int k = 0; k < 4; k++) h = (h ^ lane[k]) * 1099511628211ull;
+    return fnv64(h, p + i, len - i);
+}
+
+// A imagem depende do layout de AST deste binario, entao a chave inclui o
+// formato e o tamanho do no, alem da versao e do --no-opt.
+static uint64_t cache_key(const char *data, size_t len, int opt) {
+    uint64_t h = 14695981039346656037ull;
+    h = fnv64(h, MACSLANG_VERSION, sizeof(MACSLANG_VERSION));
+    int meta[3] = { CACHE_FORMAT, (int)sizeof(AST), opt };
+    h = fnv64(h, meta, sizeof(meta));
+    return fnv64(h, data, len);
+}
+
+char *cache_default_dir(void) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char *dir;
+    if (xdg && *xdg) {
+        dir = malloc(strlen(xdg) + 16);
+        sprintf(dir, "%s/macslang", xdg);
+    } else if (home && *home) {
+        dir = malloc(strlen(home) + 24);
+        sprintf(dir, "%s/.cache/macslang", home);
+    } else {
+        return NULL;
+    }
+    return dir;
+}
+
+char *cache_path(const char *dir, const char *data, size_t len, int opt) {
+    char *path = malloc(strlen(dir) + 32);
+    sprintf(path, "%s/%016llx" CACHE_EXT, dir, (unsigned long long)cache_key(data, len, opt));
+    return path;
+}
+
+// ---- Gravacao ----
+
+static _Thread_local char *out;
+static _Thread_local size_t out_len, out_cap;
+
+// Reserva `size` bytes alinhados a 8 na imagem; devolve o deslocamento.
+static size_t reserve(size_t size) {
+    size_t at = (out_len + 7) & ~(size_t)7;
+    while (at + size > out_cap) {
+        out_cap = out_cap ? out_cap * 2 : 4096;
+        out = realloc(out, out_cap);
+    }
+    memset(out + out_len, 0, at + size - out_len);
+    out_len = at + size;
+    return at;
+}
+
+#define AT(type, at) ((type*)(out + (at)))
+#define REF(at) ((void*)(uintptr_t)((at) + 1))
+
+static void *put_str(Str *s) {
+    size_t at = reserve(sizeof(Str));
+    size_t chars = reserve(s->len + 1);
+    memcpy(out + chars, s->chars, s->len);
+    AT(Str, at)->refs = STR_STATIC;
+    AT(Str, at)->len = AT(Str, at)->cap = s->len;
+    AT(Str, at)->chars = REF(chars);
+    return REF(at);
+}
+
+// Copia o no e depois seus filhos; `out` pode ser realocado a cada filho,
+// entao o no e sempre reacessado pelo deslocamento.
+static void *put_node(AST *ast) {
+    if (!ast) return NULL;
+    size_t size = ast_size(ast->type);
+    int list = ast->type == AST_PROGRAM || ast->type == AST_FUNC_CALL || ast->type == AST_SPAWN || ast->type == AST_CONCAT;
+    size_t at = reserve(size + (list ? sizeof(AST*) * ast->list.count : 0));
+    memcpy(out + at, ast, size);
+    void *ref;
+    switch (ast->type) {
+        case AST_LITERAL:
+            if (ast->lit.str_value) {
+                ref = put_str(ast->lit.str_value);
+                AT(AST, at)->lit.str_value = ref;
+            }
+            break;
+        case AST_BINOP:
+            ref = put_node(ast->bin.left);
+            AT(AST, at)->bin.left = ref;
+            ref = put_node(ast->bin.right);
+            AT(AST, at)->bin.right = ref;
+            break;
+        case AST_VAR_DECL:
+        case AST_ASSIGN:
+        case AST_PRINT:
+        case AST_RETURN:
+        case AST_AWAIT:
+            ref = put_node(ast->stmt.expr);
+            AT(AST, at)->stmt.expr = ref;
+            break;
+        case AST_PROGRAM:
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+        case AST_CONCAT:
+            AT(AST, at)->list.items = REF(at + size);
+            for (int i = 0; i < ast->list.count; i++) {
+                ref = put_node(ast->list.items[i]);
+                AT(AST*, at + size)[i] = ref;
+            }
+            break;
+        case AST_IF:
+            ref = put_node(ast->branch.cond);
+            AT(AST, at)->branch.cond = ref;
+            ref = put_node(ast->branch.then_body);
+            AT(AST, at)->branch.then_body = ref;
+            ref = put_node(ast->branch.else_body);
+            AT(AST, at)->branch.else_body = ref;
+            break;
+        case AST_WHILE:
+        case AST_FOR:
+            ref = put_node(ast->loop.cond);
+            AT(AST, at)->loop.cond = ref;
+            ref = put_node(ast->loop.body);
+            AT(AST, at)->loop.body = ref;
+            ref = put_node(ast->loop.init);
+            AT(AST, at)->loop.init = ref;
+            ref = put_node(ast->loop.incr);
+            AT(AST, at)->loop.incr = ref;
+            break;
+        case AST_PARALLEL_FOR:
+            ref = put_node(ast->par.loop);
+            AT(AST, at)->par.loop = ref;
+            ref = put_node(ast->par.reduce);
+            AT(AST, at)->par.reduce = ref;
+            break;
+        case AST_FUNC_DECL: {
+            ref = put_node(ast->func.body);
+            AT(AST, at)->func.body = ref;
+            size_t n = sizeof(Param) * ast->func.params_count;
+            size_t params = reserve(n);
+            if (n) memcpy(out + params, ast->func.params, n);
+            AT(AST, at)->func.params = REF(params);
+            break;
+        }
+        default:
+            break;
+    }
+    return REF(at);
+}
+
+// Cria os diretorios de `dir` que faltam.
+static int make_dirs(const char *dir) {
+    char *path = strdup(dir);
+    for (char *p = path + 1; ; p++) {
+        if (*p != '/' && *p != '\0') continue;
+        char c = *p;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            free(path);
+            return -1;
+        }
+        if (c == '\0') break;
+        *p = c;
+    }
+    free(path);
+    return 0;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int cache_store(const char *file, AST *program, const char *data, size_t len, int opt) {
+    out = NULL;
+    out_len = out_cap = 0;
+    void *root = put_node(program);
+
+    // Nomes: tamanho (uint32) seguido dos bytes, sem alinhamento.
+    char *syms = NULL;
+    size_t syms_len = 0;
+    int sym_total = sym_count();
+    for (int id = SYM_PREDEFINED_COUNT; id < sym_total; id++) {
+        const char *name = sym_name(id);
+        uint32_t n = (uint32_t)strlen(name);
+        syms = realloc(syms, syms_len + sizeof(n) + n);
+        memcpy(syms + syms_len, &n, sizeof(n));
+        memcpy(syms + syms_len + sizeof(n), name, n);
+        syms_len += sizeof(n) + n;
+    }
+
+    CacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, cache_magic, sizeof(h.magic));
+    h.key = cache_key(data, len, opt);
+    h.source_len = len;
+    h.image_offset = (sizeof(h) + 15) & ~(size_t)15;
+    h.image_len = out_len;
+    h.syms_offset = h.image_offset + out_len;
+    h.sym_count = (uint32_t)(sym_total - SYM_PREDEFINED_COUNT);
+    h.root = (uint32_t)(uintptr_t)root;
+    h.check = content_hash(content_hash(h.key, out, out_len), syms, syms_len);
+
+    // Grava num temporario e renomeia: quem le nunca ve um arquivo pela metade.
+    int status = -1;
+    char *dir = strdup(file);
+    char *slash = strrchr(dir, '/');
+    if (slash) *slash = '\0';
+    char *tmp = malloc(strlen(file) + 32);
+    sprintf(tmp, "%s.%d.tmp", file, (int)getpid());
+    if (!slash || make_dirs(dir) == 0) {
+        int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            static const char pad[16];
+            int ok = write_all(fd, &h, sizeof(h)) == 0 &&
+                     write_all(fd, pad, h.image_offset - sizeof(h)) == 0 &&
+                     write_all(fd, out, out_len) == 0 &&
+                     write_all(fd, syms, syms_len) == 0;
+            close(fd);
+            if (ok && rename(tmp, file) == 0) status = 0;
+            else unlink(tmp);
+        }
+    }
+    free(tmp);
+    free(dir);
+    free(syms);
+    free(out);
+    out = NULL;
+    out_len = out_cap = 0;
+    return status;
+}
+
+// ---- Carga ----
+
+static _Thread_local char *image;
+static _Thread_local size_t image_len;
+static _Thread_local size_t next;       // fim do ultimo pedaco corrigido
+static _Thread_local int syms;          // ids validos: 0 .. syms - 1
+static _Thread_local int broken;
+
+// Converte a referencia gravada em ponteiro. put_node grava cada pedaco (no,
+// string, parametros) depois dos que o antecedem no percurso em pre-ordem, e
+// fix_node percorre na mesma ordem: um pedaco fora da imagem, desalinhado ou
+// antes do fim do anterior (filho antes do pai, no compartilhado ou ciclo) e
+// rejeitado.
+static void *unref(void *ref, size_t size) {
+    uintptr_t at = (uintptr_t)ref;
+    if (!at || broken) return NULL;
+    at--;
+    if (at < next || at % 8 || at > image_len || size > image_len - at) {
+        broken = 1;
+        return NULL;
+    }
+    next = at + size;
+    return image + at;
+}
+
+static int bad_sym(int id) {
+    return id < 0 || id >= syms;
+}
+
+// Confere os campos escalares do no. A AST gravada ainda nao passou pelo
+// resolve, entao slots, profundidade, funcao ligada e locais sao zero.
+static int bad_node(AST *ast) {
+    if (ast->vtype > TYPE_TASK || ast->depth || bad_sym(ast->sym) || ast->op > (ast->type == AST_BINOP ? OP_GTE : 1))
+        return 1;
+    switch (ast->type) {
+        case AST_LITERAL:
+        case AST_BINOP:
+        case AST_IF:
+        case AST_WHILE:
+        case AST_FOR:
+        case AST_PARALLEL_FOR:
+            return 0;
+        case AST_IDENTIFIER:
+        case AST_INPUT:
+            return ast->var.slot != 0;
+        case AST_VAR_DECL:
+        case AST_ASSIGN:
+        case AST_PRINT:
+        case AST_RETURN:
+        case AST_AWAIT:
+            return bad_sym(ast->stmt.type_sym) || ast->stmt.slot != 0;
+        case AST_PROGRAM:
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+        case AST_CONCAT:
+            return ast->list.count < 0 || (size_t)ast->list.count > image_len / sizeof(AST*) || ast->list.index != 0;
+        case AST_FUNC_DECL:
+            return bad_sym(ast->func.type_sym) || ast->func.locals != 0 || ast->func.params_count < 0 ||
+                   (size_t)ast->func.params_count > image_len / sizeof(Param);
+        default:
+            return 1;
+    }
+}
+
+static int is(AST *ast, ASTType type) {
+    return ast && ast->type == type;
+}
+
+// Filhos que o parser sempre cria, e com o tipo que os passes esperam.
+static int bad_shape(AST *ast) {
+    switch (ast->type) {
+        case AST_BINOP:
+            return !ast->bin.left || !ast->bin.right;
+        case AST_ASSIGN:
+        case AST_PRINT:
+        case AST_AWAIT:
+            return !ast->stmt.expr;
+        case AST_IF:
+            return !ast->branch.cond || !is(ast->branch.then_body, AST_PROGRAM) ||
+                   (ast->branch.else_body && !is(ast->branch.else_body, AST_PROGRAM));
+        case AST_WHILE:
+            return !ast->loop.cond || !is(ast->loop.body, AST_PROGRAM);
+        case AST_FOR:
+            return !ast->loop.cond || !is(ast->loop.body, AST_PROGRAM) || !is(ast->loop.incr, AST_ASSIGN) ||
+                   !(is(ast->loop.init, AST_VAR_DECL) || is(ast->loop.init, AST_ASSIGN));
+        case AST_PARALLEL_FOR:
+            return !is(ast->par.loop, AST_FOR) || (ast->par.reduce && !is(ast->par.reduce, AST_IDENTIFIER));
+        case AST_FUNC_DECL:
+            return !is(ast->func.body, AST_PROGRAM);
+        default:
+            return 0;
+    }
+}
+
+static AST *fix_node(AST *ref) {
+    uintptr_t at = (uintptr_t)ref;
+    if (!at || broken) return NULL;
+    // O tamanho depende do tipo e, nas listas, da contagem: confere primeiro
+    // o no sem os itens.
+    if (at - 1 < next || at - 1 >= image_len || (at - 1) % 8) {
+        broken = 1;
+        return NULL;
+    }
+    AST *peek = (AST*)(image + at - 1);
+    if (peek->type > AST_AWAIT || image_len - (at - 1) < ast_size(peek->type) || bad_node(peek)) {
+        broken = 1;
+        return NULL;
+    }
+    size_t size = ast_size(peek->type);
+    int list = peek->type == AST_PROGRAM || peek->type == AST_FUNC_CALL || peek->type == AST_SPAWN || peek->type == AST_CONCAT;
+    if (list) size += sizeof(AST*) * (size_t)peek->list.count;
+    AST *ast = unref(ref, size);
+    if (!ast) return NULL;
+    switch (ast->type) {
+        case AST_LITERAL:
+            if (ast->lit.str_value) {
+                Str *s = unref(ast->lit.str_value, sizeof(Str));
+                ast->lit.str_value = s;
+                if (!s) break;
+                if (s->refs != STR_STATIC || s->len < 0 || s->cap != s->len) {
+                    broken = 1;
+                    break;
+                }
+                s->chars = unref(s->chars, (size_t)s->len + 1);
+                if (s->chars && s->chars[s->len] != '\0') broken = 1;
+            }
+            break;
+        case AST_BINOP:
+            ast->bin.left = fix_node(ast->bin.left);
+            ast->bin.right = fix_node(ast->bin.right);
+            break;
+        case AST_VAR_DECL:
+        case AST_ASSIGN:
+        case AST_PRINT:
+        case AST_RETURN:
+        case AST_AWAIT:
+            ast->stmt.expr = fix_node(ast->stmt.expr);
+            break;
+        case AST_PROGRAM:
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+        case AST_CONCAT:
+            // Os itens ficam logo apos o no, dentro do pedaco ja conferido.
+            if ((uintptr_t)ast->list.items != at + ast_size(ast->type)) {
+                broken = 1;
+                break;
+            }
+            ast->list.items = (AST**)((char*)ast + ast_size(ast->type));
+            for (int i = 0; i < ast->list.count; i++) ast->list.items[i] = fix_node(ast->list.items[i]);
+            break;
+        case AST_IF:
+            ast->branch.cond = fix_node(ast->branch.cond);
+            ast->branch.then_body = fix_node(ast->branch.then_body);
+            ast->branch.else_body = fix_node(ast->branch.else_body);
+            break;
+        case AST_WHILE:
+        case AST_FOR:
+            ast->loop.cond = fix_node(ast->loop.cond);
+            ast->loop.body = fix_node(ast->loop.body);
+            ast->loop.init = fix_node(ast->loop.init);
+            ast->loop.incr = fix_node(ast->loop.incr);
+            break;
+        case AST_PARALLEL_FOR:
+            ast->par.loop = fix_node(ast->par.loop);
+            ast->par.reduce = fix_node(ast->par.reduce);
+            break;
+        case AST_FUNC_DECL:
+            ast->func.body = fix_node(ast->func.body);
+            ast->func.params = unref(ast->func.params, sizeof(Param) * (size_t)ast->func.params_count);
+            if (!ast->func.params) {
+                broken = 1;
+                break;
+            }
+            for (int i = 0; i < ast->func.params_count; i++)
+                if (bad_sym(ast->func.params[i].name) || bad_sym(ast->func.params[i].type)) broken = 1;
+            break;
+        default:
+            break;
+    }
+    if (!broken && bad_shape(ast)) broken = 1;
+    return ast;
+}
+
+AST *cache_load(const char *file, const char *data, size_t len, int opt, CacheImage *img) {
+    img->map = NULL;
+    img->len = 0;
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t map_len = (size_t)st.st_size;
+    // Privado e gravavel: a correcao dos ponteiros (e o resolve depois) so
+    // copia as paginas tocadas, sem alterar o arquivo.
+    char *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    // Tudo e conferido antes de internar nomes ou corrigir ponteiros.
+    CacheHeader *h = (CacheHeader*)map;
+    if (memcmp(h->magic, cache_magic, sizeof(h->magic)) != 0 || h->key != cache_key(data, len, opt) ||
+        h->source_len != len || h->image_offset % 16 || h->image_offset > map_len ||
+        h->image_len > map_len - h->image_offset || h->syms_offset != h->image_offset + h->image_len ||
+        h->check != content_hash(content_hash(h->key, map + h->image_offset, h->image_len),
+                                 map + h->syms_offset, map_len - h->syms_offset) ||
+        sym_count() != SYM_PREDEFINED_COUNT) {
+        munmap(map, map_len);
+        return NULL;
+    }
+
+    const char *p = map + h->syms_offset, *end = map + map_len;
+    for (uint32_t i = 0; i < h->sym_count; i++) {
+        uint32_t n;
+        if ((size_t)(end - p) < sizeof(n)) break;
+        memcpy(&n, p, sizeof(n));
+        p += sizeof(n);
+        if ((size_t)(end - p) < n || sym_intern(p, (int)n) != (int)(SYM_PREDEFINED_COUNT + i)) break;
+        p += n;
+    }
+    image = map + h->image_offset;
+    image_len = h->image_len;
+    next = 0;
+    syms = sym_count();
+    broken = p != end || syms != (int)(SYM_PREDEFINED_COUNT + h->sym_count);
+    AST *program = broken ? NULL : fix_node((AST*)(uintptr_t)h->root);
+    if (broken || !program || program->type != AST_PROGRAM || next != image_len) {
+        // Simbolos ja internados ficam na tabela; o parse os reaproveita.
+        munmap(map, map_len);
+        return NULL;
+    }
+    img->map = map;
+    img->len = map_len;
+    return program;
+}
+
+void cache_unload(CacheImage *img) {
+    if (img->map) munmap(img->map, img->len);
+    img->map = NULL;
+    img->len = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef CACHE_H
+#define CACHE_H
+#include <stddef.h>
+#include "parser.h"
+
+// Cache em disco do programa ja analisado. Depois do parse, typecheck e
+// optimize, a AST e gravada num arquivo .macslangc cujo nome e um hash do
+// fonte, da versao do interpretador e das opcoes que mudam a arvore. Nas
+// execucoes seguintes o arquivo e mapeado com mmap e seus ponteiros (gravados
+// como deslocamentos) sao corrigidos no lugar: nem lexer nem parser rodam.
+// Um arquivo truncado, corrompido ou que nao bate com a ordem em que a arvore
+// foi gravada e recusado, e o programa e analisado de novo.
+
+#define MACSLANG_VERSION "1.0"
+#define CACHE_FORMAT 5
+#define CACHE_EXT ".macslangc"
+
+// Arquivo mapeado que sustenta a AST carregada; solto no fim da execucao.
+typedef struct {
+    void *map;
+    size_t len;
+} CacheImage;
+
+// $XDG_CACHE_HOME/macslang ou $HOME/.cache/macslang (malloc); NULL sem HOME.
+char *cache_default_dir(void);
+// Caminho do arquivo de cache do fonte `data` em `dir` (malloc).
+char *cache_path(const char *dir, const char *data, size_t len, int opt);
+// Carrega o programa de `file`; NULL se o arquivo nao existe ou nao serve.
+AST *cache_load(const char *file, const char *data, size_t len, int opt, CacheImage *image);
+// Grava `program` em `file` (criando o diretorio); devolve 0 se gravou.
+int cache_store(const char *file, AST *program, const char *data, size_t len, int opt);
+void cache_unload(CacheImage *image);
+
+#endif
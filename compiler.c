@@ -0,0 +1,291 @@
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Compilador AST -> bytecode. Os slots das variaveis ja vem do resolve:
+// parametros e locais ocupam slots do frame, globais o vetor de globais.
+
+static _Thread_local Bytecode *bc;
+static _Thread_local int in_function;
+static _Thread_local int depth, max_depth;
+
+static void compile_stmt(AST *ast);
+static void compile_expr(AST *ast);
+
+static void emit(int word) {
+    if (bc->code_len == bc->code_cap) {
+        bc->code_cap = bc->code_cap ? bc->code_cap * 2 : 256;
+        bc->code = realloc(bc->code, sizeof(int) * bc->code_cap);
+    }
+    bc->code[bc->code_len++] = word;
+}
+
+// Emite um opcode registrando seu efeito na pilha de operandos.
+static void emit_op(Opcode op, int stack_effect) {
+    emit(op);
+    depth += stack_effect;
+    if (depth > max_depth) max_depth = depth;
+}
+
+static int emit_jump(Opcode op, int stack_effect) {
+    emit_op(op, stack_effect);
+    emit(-1);
+    return bc->code_len - 1;
+}
+
+static void patch_jump(int at) {
+    bc->code[at] = bc->code_len;
+}
+
+static int add_string(Str *s) {
+    if (bc->string_count == bc->string_cap) {
+        bc->string_cap = bc->string_cap ? bc->string_cap * 2 : 16;
+        bc->strings = realloc(bc->strings, sizeof(Str*) * bc->string_cap);
+    }
+    bc->strings[bc->string_count] = s;
+    return bc->string_count++;
+}
+
+// Emite o acesso (LOAD, STORE ou INPUT) a variavel ja resolvida.
+static void emit_var(Opcode local_op, Opcode global_op, int stack_effect, AST *ast, int slot) {
+    emit_op(ast->depth == SLOT_LOCAL ? local_op : global_op, stack_effect);
+    emit(slot);
+}
+
+static void compile_call(AST *ast) {
+    int idx = ast->list.index; // ligada e com aridade verificada pelo resolve
+    VMFunc *f = &bc->funcs[idx];
+    for (int i = 0; i < ast->list.count; i++)
+        compile_expr(ast->list.items[i]);
+    emit_op(BC_CALL, 1 - f->params);
+    emit(idx);
+}
+
+// Empilha os itens de um AST_CONCAT.
+static void compile_parts(AST *concat) {
+    for (int i = 0; i < concat->list.count; i++)
+        compile_expr(concat->list.items[i]);
+}
+
+static void compile_expr(AST *ast) {
+    switch (ast->type) {
+        case AST_LITERAL:
+            if (ast->vtype == TYPE_STRING) {
+                emit_op(BC_PUSH_STR, 1);
+                emit(add_string(ast->lit.str_value));
+            } else if (ast->vtype == TYPE_BOOL) {
+                emit_op(BC_PUSH_BOOL, 1);
+                emit(ast->lit.int_value);
+            } else {
+                emit_op(BC_PUSH_INT, 1);
+                emit(ast->lit.int_value);
+            }
+            break;
+        case AST_IDENTIFIER:
+            emit_var(BC_LOAD_LOCAL, BC_LOAD_GLOBAL, 1, ast, ast->var.slot);
+            break;
+        case AST_BINOP:
+            compile_expr(ast->bin.left);
+            compile_expr(ast->bin.right);
+            emit_op(BC_ADD + ast->op, -1);
+            break;
+        case AST_FUNC_CALL:
+            compile_call(ast);
+            break;
+        // A VM nao tem tarefas: spawn chama na hora e o handle ja e o
+        // resultado, que await devolve.
+        case AST_SPAWN:
+            compile_call(ast);
+            break;
+        case AST_AWAIT:
+            compile_expr(ast->stmt.expr);
+            break;
+        case AST_CONCAT:
+            compile_parts(ast);
+            emit_op(BC_CONCAT, 1 - ast->list.count);
+            emit(ast->list.count);
+            break;
+        default:
+            emit_op(BC_PUSH_NONE, 1);
+            break;
+    }
+}
+
+// `x = x + a + b ...` marcado como ASSIGN_APPEND: o primeiro item da
+// concatenacao e x, os demais sao anexados um a um.
+static void compile_append(AST *assign) {
+    AST *concat = assign->stmt.expr;
+    for (int i = 1; i < concat->list.count; i++) {
+        compile_expr(concat->list.items[i]);
+        emit_var(BC_APPEND_LOCAL, BC_APPEND_GLOBAL, -1, assign, assign->stmt.slot);
+    }
+}
+
+static void compile_stmt(AST *ast) {
+    switch (ast->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                compile_stmt(ast->list.items[i]);
+            break;
+        case AST_VAR_DECL:
+            if (ast->op == DECL_ONLY) break;
+            if (ast->stmt.expr) compile_expr(ast->stmt.expr);
+            else emit_op(BC_PUSH_NONE, 1);
+            emit_var(BC_DECL_LOCAL, BC_DECL_GLOBAL, -1, ast, ast->stmt.slot);
+            emit(ast->stmt.type_sym);
+            break;
+        case AST_ASSIGN:
+            if (ast->op == ASSIGN_APPEND) {
+                compile_append(ast);
+                break;
+            }
+            compile_expr(ast->stmt.expr);
+            emit_var(BC_STORE_LOCAL, BC_STORE_GLOBAL, -1, ast, ast->stmt.slot);
+            break;
+        case AST_PRINT:
+            if (ast->stmt.expr && ast->stmt.expr->type == AST_CONCAT) {
+                compile_parts(ast->stmt.expr);
+                emit_op(BC_PRINT_CONCAT, -ast->stmt.expr->list.count);
+                emit(ast->stmt.expr->list.count);
+                break;
+            }
+            compile_expr(ast->stmt.expr);
+            emit_op(BC_PRINT, -1);
+            break;
+        case AST_INPUT:
+            emit_var(BC_INPUT_LOCAL, BC_INPUT_GLOBAL, 0, ast, ast->var.slot);
+            break;
+        case AST_IF: {
+            compile_expr(ast->branch.cond);
+            int to_else = emit_jump(BC_JUMP_IF_FALSE, -1);
+            compile_stmt(ast->branch.then_body);
+            if (ast->branch.else_body) {
+                int to_end = emit_jump(BC_JUMP, 0);
+                patch_jump(to_else);
+                compile_stmt(ast->branch.else_body);
+                patch_jump(to_end);
+            } else {
+                patch_jump(to_else);
+            }
+            break;
+        }
+        case AST_WHILE: {
+            int top = bc->code_len;
+            compile_expr(ast->loop.cond);
+            int to_end = emit_jump(BC_JUMP_IF_FALSE, -1);
+            compile_stmt(ast->loop.body);
+            emit_op(BC_JUMP, 0);
+            emit(top);
+            patch_jump(to_end);
+            break;
+        }
+        case AST_FOR: {
+            if (ast->op == FOR_COUNTED) {
+                // Testa a condicao uma vez na entrada; depois o LOOP_INT no
+                // fim do corpo incrementa, compara e volta ao topo.
+                AST *cond = ast->loop.cond, *bound = cond->bin.right;
+                AST *step = ast->loop.incr->stmt.expr;
+                compile_stmt(ast->loop.init);
+                compile_expr(cond);
+                int to_end = emit_jump(BC_JUMP_IF_FALSE, -1);
+                int top = bc->code_len;
+                compile_stmt(ast->loop.body);
+                int delta = step->bin.right->lit.int_value;
+                emit_op(BC_LOOP_INT, 0);
+                emit(ast->loop.incr->stmt.slot);
+                emit(step->op == OP_SUB ? (int)(0u - (unsigned int)delta) : delta);
+                emit(cond->op);
+                emit(bound->type == AST_LITERAL ? -1 : bound->var.slot);
+                emit(bound->type == AST_LITERAL ? bound->lit.int_value : 0);
+                emit(top);
+                patch_jump(to_end);
+                break;
+            }
+            compile_stmt(ast->loop.init);
+            int top = bc->code_len;
+            compile_expr(ast->loop.cond);
+            int to_end = emit_jump(BC_JUMP_IF_FALSE, -1);
+            compile_stmt(ast->loop.body);
+            compile_stmt(ast->loop.incr);
+            emit_op(BC_JUMP, 0);
+            emit(top);
+            patch_jump(to_end);
+            break;
+        }
+        case AST_PARALLEL_FOR:
+            // A VM roda o laco em sequencia: as restricoes do parallel for
+            // garantem o mesmo resultado.
+            compile_stmt(ast->par.loop);
+            break;
+        case AST_FUNC_CALL:
+            compile_call(ast);
+            emit_op(BC_POP, -1);
+            break;
+        case AST_RETURN:
+            compile_expr(ast->stmt.expr);
+            if (in_function) {
+                emit_op(BC_RETURN, -1);
+            } else {
+                emit_op(BC_POP, -1); // return fora de funcao e ignorado
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void compile_function(VMFunc *f, AST *decl) {
+    depth = max_depth = 0;
+    in_function = 1;
+    f->entry = bc->code_len;
+    compile_stmt(decl->func.body);
+    emit_op(BC_PUSH_NONE, 1);
+    emit_op(BC_RETURN, -1);
+    f->locals = decl->func.locals;
+    f->stack = f->locals + max_depth;
+}
+
+Bytecode *vm_compile(AST *program, Frames frames) {
+    bc = calloc(1, sizeof(Bytecode));
+    bc->globals = frames.globals;
+
+    // Uma VMFunc por declaracao, na ordem usada pelo resolve em list.index.
+    bc->funcs = calloc(program->list.count + 1, sizeof(VMFunc));
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type != AST_FUNC_DECL) continue;
+        VMFunc *f = &bc->funcs[bc->func_count];
+        f->sym = stmt->sym;
+        f->params = stmt->func.params_count;
+        bc->func_count++;
+    }
+
+    depth = max_depth = 0;
+    in_function = 0;
+    bc->main.entry = bc->code_len;
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type != AST_FUNC_DECL)
+            compile_stmt(stmt);
+    }
+    emit_op(BC_HALT, 0);
+    bc->main.locals = frames.main_locals;
+    bc->main.stack = bc->main.locals + max_depth;
+
+    int n = 0;
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type == AST_FUNC_DECL)
+            compile_function(&bc->funcs[n++], stmt);
+    }
+
+    return bc;
+}
+
+void vm_free(Bytecode *b) {
+    free(b->code);
+    free(b->strings);
+    free(b->funcs);
+    free(b);
+}
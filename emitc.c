@@ -0,0 +1,865 @@
+#include "emitc.h"
+#include "symtab.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <limits.h>
+
+// Runtime copiado no inicio de todo programa gerado: strings com contagem de
+// referencias (como str.c), concatenacao/print por partes e I/O com buffer
+// proprio (como value.c e io.c), para que a saida seja a mesma do interpretador.
+// As funcoes sao `static inline` para que as nao usadas nao gerem avisos.
+static const char *runtime =
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <errno.h>\n"
+    "#include <unistd.h>\n"
+    "\n"
+    "typedef struct { int refs; int len; int cap; char *chars; } Str;\n"
+    "typedef struct { Str *s; int i; char kind; } RtPart;\n"
+    "\n"
+    "// Literais sao Str estaticas (refs == RT_STATIC), nunca liberadas; depois de\n"
+    "// inlining o GCC nao enxerga isso e avisaria de free() sobre elas.\n"
+    "#if defined(__GNUC__) && !defined(__clang__)\n"
+    "#pragma GCC diagnostic ignored \"-Wfree-nonheap-object\"\n"
+    "#endif\n"
+    "\n"
+    "#define RT_STATIC (-1)\n"
+    "#define RT_BUFFER (64 * 1024)\n"
+    "\n"
+    "static Str rt_empty = { RT_STATIC, 0, 0, \"\" };\n"
+    "static char rt_out[RT_BUFFER], rt_in[RT_BUFFER];\n"
+    "static size_t rt_out_len, rt_in_pos, rt_in_len;\n"
+    "static int rt_in_eof;\n"
+    "\n"
+    "static inline void rt_write_all(const char *s, size_t len) {\n"
+    "    while (len > 0) {\n"
+    "        ssize_t n = write(1, s, len);\n"
+    "        if (n < 0) { if (errno == EINTR) continue; return; }\n"
+    "        s += n;\n"
+    "        len -= (size_t)n;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static inline void rt_flush(void) {\n"
+    "    rt_write_all(rt_out, rt_out_len);\n"
+    "    rt_out_len = 0;\n"
+    "}\n"
+    "\n"
+    "static inline void rt_write(const char *s, size_t len) {\n"
+    "    if (rt_out_len + len > RT_BUFFER) {\n"
+    "        rt_flush();\n"
+    "        if (len >= RT_BUFFER) { rt_write_all(s, len); return; }\n"
+    "    }\n"
+    "    memcpy(rt_out + rt_out_len, s, len);\n"
+    "    rt_out_len += len;\n"
+    "}\n"
+    "\n"
+    "static inline Str *rt_alloc(int len, int cap) {\n"
+    "    Str *s = malloc(sizeof(Str) + (size_t)cap + 1);\n"
+    "    if (!s) abort();\n"
+    "    s->refs = 1;\n"
+    "    s->len = len;\n"
+    "    s->cap = cap;\n"
+    "    s->chars = (char *)(s + 1);\n"
+    "    s->chars[len] = '\\0';\n"
+    "    return s;\n"
+    "}\n"
+    "\n"
+    "static inline Str *rt_retain(Str *s) { if (s->refs != RT_STATIC) s->refs++; return s; }\n"
+    "static inline void rt_release(Str *s) { if (s->refs != RT_STATIC && --s->refs == 0) free(s); }\n"
+    "static inline void rt_store(Str **var, Str *v) { rt_release(*var); *var = v; }\n"
+    "static inline int rt_div(int l, int r) { if (r == 0) return 0; if (r == -1) return (int)(0u - (unsigned int)l); return l / r; }\n"
+    "static inline int rt_mod(int l, int r) { if (r == 0 || r == -1) return 0; return l % r; }\n"
+    "static inline RtPart rt_ps(Str *s) { RtPart p = { s, 0, 's' }; return p; }\n"
+    "static inline RtPart rt_pi(int i) { RtPart p = { 0, i, 'i' }; return p; }\n"
+    "static inline RtPart rt_pb(int b) { RtPart p = { 0, b, 'b' }; return p; }\n"
+    "\n"
+    "static inline const char *rt_text(const RtPart *p, char *tmp, int *len) {\n"
+    "    if (p->kind == 's') { *len = p->s->len; return p->s->chars; }\n"
+    "    if (p->kind == 'b') { *len = p->i ? 4 : 5; return p->i ? \"true\" : \"false\"; }\n"
+    "    unsigned int u = p->i < 0 ? 0u - (unsigned int)p->i : (unsigned int)p->i;\n"
+    "    char *end = tmp + 12, *q = end;\n"
+    "    do { *--q = (char)('0' + u % 10); u /= 10; } while (u);\n"
+    "    if (p->i < 0) *--q = '-';\n"
+    "    *len = (int)(end - q);\n"
+    "    return q;\n"
+    "}\n"
+    "\n"
+    "static inline Str *rt_concat(int n, const RtPart *parts) {\n"
+    "    char tmp[12];\n"
+    "    int total = 0, len, i;\n"
+    "    for (i = 0; i < n; i++) { rt_text(&parts[i], tmp, &len); total += len; }\n"
+    "    Str *s = rt_alloc(total, total);\n"
+    "    char *out = s->chars;\n"
+    "    for (i = 0; i < n; i++) {\n"
+    "        const char *text = rt_text(&parts[i], tmp, &len);\n"
+    "        memcpy(out, text, len);\n"
+    "        out += len;\n"
+    "        if (parts[i].kind == 's') rt_release(parts[i].s);\n"
+    "    }\n"
+    "    return s;\n"
+    "}\n"
+    "\n"
+    "static inline void rt_print(int n, const RtPart *parts) {\n"
+    "    char tmp[12];\n"
+    "    int len, i;\n"
+    "    for (i = 0; i < n; i++) {\n"
+    "        const char *text = rt_text(&parts[i], tmp, &len);\n"
+    "        rt_write(text, (size_t)len);\n"
+    "        if (parts[i].kind == 's') rt_release(parts[i].s);\n"
+    "    }\n"
+    "    rt_write(\"\\n\", 1);\n"
+    "}\n"
+    "\n"
+    "static inline Str *rt_append_text(Str *s, const char *text, int len) {\n"
+    "    int need = s->len + len;\n"
+    "    if (s->refs != 1 || need > s->cap) {\n"
+    "        int cap = need < 16 ? 16 : need + need / 2;\n"
+    "        Str *grown;\n"
+    "        if (s->refs == 1) {\n"
+    "            grown = realloc(s, sizeof(Str) + (size_t)cap + 1);\n"
+    "            if (!grown) abort();\n"
+    "            grown->cap = cap;\n"
+    "            grown->chars = (char *)(grown + 1);\n"
+    "        } else {\n"
+    "            grown = rt_alloc(s->len, cap);\n"
+    "            memcpy(grown->chars, s->chars, s->len);\n"
+    "            rt_release(s);\n"
+    "        }\n"
+    "        s = grown;\n"
+    "    }\n"
+    "    memcpy(s->chars + s->len, text, len);\n"
+    "    s->len = need;\n"
+    "    s->chars[need] = '\\0';\n"
+    "    return s;\n"
+    "}\n"
+    "\n"
+    "static inline Str *rt_append(Str *s, RtPart p) {\n"
+    "    char tmp[12];\n"
+    "    int len;\n"
+    "    const char *text = rt_text(&p, tmp, &len);\n"
+    "    s = rt_append_text(s, text, len);\n"
+    "    if (p.kind == 's') rt_release(p.s);\n"
+    "    return s;\n"
+    "}\n"
+    "\n"
+    "static inline int rt_streq(Str *a, Str *b) {\n"
+    "    int eq = a == b || (a->len == b->len && memcmp(a->chars, b->chars, a->len) == 0);\n"
+    "    rt_release(a);\n"
+    "    rt_release(b);\n"
+    "    return eq;\n"
+    "}\n"
+    "\n"
+    "static inline int rt_peek(void) {\n"
+    "    if (rt_in_pos == rt_in_len) {\n"
+    "        ssize_t n;\n"
+    "        if (rt_in_eof) return -1;\n"
+    "        do n = read(0, rt_in, sizeof(rt_in)); while (n < 0 && errno == EINTR);\n"
+    "        if (n <= 0) { rt_in_eof = 1; return -1; }\n"
+    "        rt_in_pos = 0;\n"
+    "        rt_in_len = (size_t)n;\n"
+    "    }\n"
+    "    return (unsigned char)rt_in[rt_in_pos];\n"
+    "}\n"
+    "\n"
+    "static inline int rt_read_int(void) {\n"
+    "    int c, neg = 0;\n"
+    "    unsigned int value = 0;\n"
+    "    rt_flush();\n"
+    "    while ((c = rt_peek()) == ' ' || c == '\\t' || c == '\\n' || c == '\\r' || c == '\\v' || c == '\\f')\n"
+    "        rt_in_pos++;\n"
+    "    if (c == '-' || c == '+') { neg = c == '-'; rt_in_pos++; c = rt_peek(); }\n"
+    "    if (c < '0' || c > '9') return 0;\n"
+    "    while ((c = rt_peek()) >= '0' && c <= '9') { value = value * 10 + (unsigned int)(c - '0'); rt_in_pos++; }\n"
+    "    return neg ? (int)(0u - value) : (int)value;\n"
+    "}\n"
+    "\n"
+    "static inline Str *rt_read_line(void) {\n"
+    "    Str *s = &rt_empty;\n"
+    "    rt_flush();\n"
+    "    while (rt_peek() != -1) {\n"
+    "        char *nl = memchr(rt_in + rt_in_pos, '\\n', rt_in_len - rt_in_pos);\n"
+    "        size_t chunk = nl ? (size_t)(nl - (rt_in + rt_in_pos)) : rt_in_len - rt_in_pos;\n"
+    "        s = rt_append_text(s, rt_in + rt_in_pos, (int)chunk);\n"
+    "        rt_in_pos += chunk;\n"
+    "        if (nl) { rt_in_pos++; break; }\n"
+    "    }\n"
+    "    return s;\n"
+    "}\n";
+
+// Texto de uma expressao C em construcao.
+typedef struct {
+    char *data;
+    size_t len, cap;
+} Text;
+
+static void text_add(Text *t, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (t->len + n + 1 > t->cap) {
+        t->cap = (t->len + n + 1) * 2;
+        t->data = realloc(t->data, t->cap);
+    }
+    va_start(ap, fmt);
+    vsnprintf(t->data + t->len, n + 1, fmt, ap);
+    va_end(ap);
+    t->len += n;
+}
+
+// Variavel C de um slot: a mesma (profundidade, slot) pode guardar tipos e
+// nomes diferentes em `for`s distintos, entao os tres entram no nome.
+typedef struct {
+    unsigned char depth, type;
+    int slot, sym;
+} VarKey;
+
+static _Thread_local FILE *body;          // codigo das funcoes, escrito antes dos literais
+static _Thread_local int indent;
+static _Thread_local int temp_count;
+static _Thread_local int in_function, uses_out;
+static _Thread_local int temps_pending, temps_opened;
+static _Thread_local int bare;            // a proxima expressao e o topo de um comando: sem parenteses
+static _Thread_local Str **literals;
+static _Thread_local int literal_count, literal_cap;
+static _Thread_local AST **funcs;         // list.index -> declaracao
+static _Thread_local VarKey *vars;
+static _Thread_local int var_count, var_cap;
+
+static void line(const char *fmt, ...) {
+    va_list ap;
+    fprintf(body, "%*s", indent * 4, "");
+    va_start(ap, fmt);
+    vfprintf(body, fmt, ap);
+    va_end(ap);
+    fputc('\n', body);
+}
+
+static TypeKind type_from_sym(int sym) {
+    if (sym == SYM_INT) return TYPE_INT;
+    if (sym == SYM_STRING) return TYPE_STRING;
+    if (sym == SYM_BOOL) return TYPE_BOOL;
+    if (sym == SYM_TASK) return TYPE_TASK;
+    return TYPE_NONE;
+}
+
+static const char *ctype(int type) {
+    return type == TYPE_STRING ? "Str *" : "int ";
+}
+
+static const char *zero(int type) {
+    return type == TYPE_STRING ? "&rt_empty" : "0";
+}
+
+static void var_name(Text *t, int depth, int slot, int type, int sym) {
+    text_add(t, "%c%d%c_%s", depth == SLOT_LOCAL ? 'l' : 'g', slot, "xisbt"[type], sym_name(sym));
+}
+
+static void add_var(int depth, int slot, int type, int sym) {
+    for (int i = 0; i < var_count; i++)
+        if (vars[i].depth == depth && vars[i].slot == slot && vars[i].type == type && vars[i].sym == sym)
+            return;
+    if (var_count == var_cap) {
+        var_cap = var_cap ? var_cap * 2 : 32;
+        vars = realloc(vars, sizeof(VarKey) * var_cap);
+    }
+    vars[var_count].depth = (unsigned char)depth;
+    vars[var_count].type = (unsigned char)type;
+    vars[var_count].slot = slot;
+    vars[var_count].sym = sym;
+    var_count++;
+}
+
+// Junta em `vars` as variaveis de profundidade `depth` usadas sob `ast`;
+// `into_funcs` desce tambem nos corpos de funcao.
+static void collect_vars(AST *ast, int depth, int into_funcs) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_PROGRAM:
+        case AST_CONCAT:
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+            for (int i = 0; i < ast->list.count; i++)
+                collect_vars(ast->list.items[i], depth, into_funcs);
+            break;
+        case AST_FUNC_DECL:
+            if (into_funcs) collect_vars(ast->func.body, depth, into_funcs);
+            break;
+        case AST_VAR_DECL:
+        case AST_ASSIGN:
+            if (ast->depth == depth) add_var(depth, ast->stmt.slot, ast->vtype, ast->sym);
+            collect_vars(ast->stmt.expr, depth, into_funcs);
+            break;
+        case AST_PRINT:
+        case AST_RETURN:
+        case AST_AWAIT:
+            collect_vars(ast->stmt.expr, depth, into_funcs);
+            break;
+        case AST_INPUT:
+        case AST_IDENTIFIER:
+            if (ast->depth == depth) add_var(depth, ast->var.slot, ast->vtype, ast->sym);
+            break;
+        case AST_BINOP:
+            collect_vars(ast->bin.left, depth, into_funcs);
+            collect_vars(ast->bin.right, depth, into_funcs);
+            break;
+        case AST_IF:
+            collect_vars(ast->branch.cond, depth, into_funcs);
+            collect_vars(ast->branch.then_body, depth, into_funcs);
+            collect_vars(ast->branch.else_body, depth, into_funcs);
+            break;
+        case AST_WHILE:
+        case AST_FOR:
+            collect_vars(ast->loop.init, depth, into_funcs);
+            collect_vars(ast->loop.cond, depth, into_funcs);
+            collect_vars(ast->loop.incr, depth, into_funcs);
+            collect_vars(ast->loop.body, depth, into_funcs);
+            break;
+        case AST_PARALLEL_FOR:
+            collect_vars(ast->par.loop, depth, into_funcs);
+            break;
+        default:
+            break;
+    }
+}
+
+static int literal_id(Str *s) {
+    for (int i = 0; i < literal_count; i++)
+        if (literals[i] == s) return i;
+    if (literal_count == literal_cap) {
+        literal_cap = literal_cap ? literal_cap * 2 : 32;
+        literals = realloc(literals, sizeof(Str*) * literal_cap);
+    }
+    literals[literal_count] = s;
+    return literal_count++;
+}
+
+static int has_call(AST *e) {
+    if (!e) return 0;
+    switch (e->type) {
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+            return 1;
+        case AST_AWAIT:
+            return has_call(e->stmt.expr);
+        case AST_BINOP:
+            return has_call(e->bin.left) || has_call(e->bin.right);
+        case AST_CONCAT:
+            for (int i = 0; i < e->list.count; i++)
+                if (has_call(e->list.items[i])) return 1;
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+// Le alguma global? Uma chamada pode muda-la; locais nao sao visiveis a ela.
+static int reads_global(AST *e) {
+    if (!e) return 0;
+    switch (e->type) {
+        case AST_IDENTIFIER:
+            return e->depth == SLOT_GLOBAL;
+        case AST_BINOP:
+            return reads_global(e->bin.left) || reads_global(e->bin.right);
+        case AST_CONCAT:
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+            for (int i = 0; i < e->list.count; i++)
+                if (reads_global(e->list.items[i])) return 1;
+            return 0;
+        case AST_AWAIT:
+            return reads_global(e->stmt.expr);
+        default:
+            return 0;
+    }
+}
+
+static void gen_expr(Text *t, AST *e);
+
+// Operando de uma expressao com chamadas: C nao fixa a ordem de avaliacao dos
+// operandos, entao, quando algum deles chama uma funcao, os que chamam ou leem
+// globais (menos o ultimo) sao avaliados antes em temporarios, da esquerda
+// para a direita como no interpretador.
+static void gen_operand(Text *t, AST *e, int ordered, int last) {
+    if (!ordered || last || (!has_call(e) && !reads_global(e))) {
+        gen_expr(t, e);
+        return;
+    }
+    if (temps_pending && !temps_opened) {
+        line("{");
+        indent++;
+        temps_opened = 1;
+    }
+    Text sub = { 0 };
+    bare = 1;
+    gen_expr(&sub, e);
+    int n = temp_count++;
+    line("%st%d = %s;", ctype(e->vtype), n, sub.data);
+    free(sub.data);
+    text_add(t, "t%d", n);
+}
+
+static void gen_part(Text *t, AST *e, int ordered, int last) {
+    text_add(t, e->vtype == TYPE_STRING ? "rt_ps(" : e->vtype == TYPE_BOOL ? "rt_pb(" : "rt_pi(");
+    gen_operand(t, e, ordered, last);
+    text_add(t, ")");
+}
+
+// Vetor de partes para rt_concat/rt_print.
+static void gen_parts(Text *t, AST **items, int n) {
+    int ordered = 0;
+    for (int i = 0; i < n; i++) ordered |= has_call(items[i]);
+    text_add(t, "%d, (RtPart[]){ ", n);
+    for (int i = 0; i < n; i++) {
+        if (i) text_add(t, ", ");
+        gen_part(t, items[i], ordered, i == n - 1);
+    }
+    text_add(t, " }");
+}
+
+static const char *c_op(int op) {
+    switch (op) {
+        case OP_ADD: return "+";
+        case OP_SUB: return "-";
+        case OP_MUL: return "*";
+        case OP_EQ: return "==";
+        case OP_NEQ: return "!=";
+        case OP_LT: return "<";
+        case OP_LTE: return "<=";
+        case OP_GT: return ">";
+        default: return ">=";
+    }
+}
+
+// Expressao C com o valor de `e`; strings saem como uma referencia propria,
+// que quem a recebe (rt_concat, rt_store, a funcao chamada...) consome.
+static void gen_expr(Text *t, AST *e) {
+    int top = bare;
+    bare = 0;
+    switch (e->type) {
+        case AST_LITERAL:
+            if (e->vtype == TYPE_STRING) text_add(t, "&k%d", literal_id(e->lit.str_value));
+            else if (e->lit.int_value == INT_MIN) text_add(t, "(-2147483647 - 1)");
+            else if (e->lit.int_value < 0) text_add(t, "(%d)", e->lit.int_value);
+            else text_add(t, "%d", e->lit.int_value);
+            break;
+        case AST_IDENTIFIER:
+            if (e->vtype == TYPE_STRING) text_add(t, "rt_retain(");
+            var_name(t, e->depth, e->var.slot, e->vtype, e->sym);
+            if (e->vtype == TYPE_STRING) text_add(t, ")");
+            break;
+        case AST_BINOP: {
+            AST *l = e->bin.left, *r = e->bin.right;
+            int ordered = has_call(l) || has_call(r);
+            if (l->vtype == TYPE_STRING || r->vtype == TYPE_STRING) {
+                if (e->op == OP_EQ || e->op == OP_NEQ) {
+                    text_add(t, e->op == OP_EQ ? "rt_streq(" : "!rt_streq(");
+                    gen_operand(t, l, ordered, 0);
+                    text_add(t, ", ");
+                    gen_operand(t, r, ordered, 1);
+                    text_add(t, ")");
+                } else {
+                    AST *items[2] = { l, r };
+                    text_add(t, "rt_concat(");
+                    gen_parts(t, items, 2);
+                    text_add(t, ")");
+                }
+            } else if (e->op == OP_DIV || e->op == OP_MOD) {
+                text_add(t, e->op == OP_DIV ? "rt_div(" : "rt_mod(");
+                gen_operand(t, l, ordered, 0);
+                text_add(t, ", ");
+                gen_operand(t, r, ordered, 1);
+                text_add(t, ")");
+            } else {
+                if (!top) text_add(t, "(");
+                gen_operand(t, l, ordered, 0);
+                text_add(t, " %s ", c_op(e->op));
+                gen_operand(t, r, ordered, 1);
+                if (!top) text_add(t, ")");
+            }
+            break;
+        }
+        case AST_CONCAT:
+            text_add(t, "rt_concat(");
+            gen_parts(t, e->list.items, e->list.count);
+            text_add(t, ")");
+            break;
+        // Sem tarefas no programa gerado: spawn chama na hora e o handle
+        // e o proprio resultado.
+        case AST_AWAIT:
+            gen_expr(t, e->stmt.expr);
+            break;
+        case AST_FUNC_CALL:
+        case AST_SPAWN: {
+            int ordered = 0, n = e->list.count;
+            for (int i = 0; i < n; i++) ordered |= has_call(e->list.items[i]);
+            text_add(t, "f%d_%s(", e->list.index, sym_name(e->sym));
+            for (int i = 0; i < n; i++) {
+                if (i) text_add(t, ", ");
+                gen_operand(t, e->list.items[i], ordered, i == n - 1);
+            }
+            text_add(t, ")");
+            break;
+        }
+        default:
+            text_add(t, "0");
+            break;
+    }
+}
+
+// Temporarios das expressoes de um comando ficam num bloco proprio, aberto
+// quando o primeiro aparece; end_temps diz se ele precisa ser fechado.
+static void begin_temps(void) {
+    temps_pending = 1;
+    temps_opened = 0;
+}
+
+static int end_temps(void) {
+    temps_pending = 0;
+    return temps_opened;
+}
+
+// Expressao no topo de um comando.
+static int gen_stmt_expr(Text *t, AST *e) {
+    begin_temps();
+    bare = 1;
+    gen_expr(t, e);
+    return end_temps();
+}
+
+static void close_temps(int opened) {
+    if (!opened) return;
+    indent--;
+    line("}");
+}
+
+static void emit_stmt(AST *s);
+
+static void emit_block(AST *s) {
+    indent++;
+    emit_stmt(s);
+    indent--;
+}
+
+// Guarda o valor ja gerado em `value` na variavel do comando.
+static void emit_store(AST *s, int depth, int slot, Text *value) {
+    Text name = { 0 };
+    var_name(&name, depth, slot, s->vtype, s->sym);
+    if (s->vtype == TYPE_STRING) line("rt_store(&%s, %s);", name.data, value->data);
+    else line("%s = %s;", name.data, value->data);
+    free(name.data);
+}
+
+// Declaracao ou atribuicao simples de int/bool, que cabe no cabecalho de um
+// `for` de C.
+static int simple_assign(AST *s, Text *out) {
+    if (!s || (s->type != AST_VAR_DECL && s->type != AST_ASSIGN)) return 0;
+    if (s->vtype == TYPE_STRING || s->vtype == TYPE_NONE || has_call(s->stmt.expr)) return 0;
+    var_name(out, s->depth, s->stmt.slot, s->vtype, s->sym);
+    text_add(out, " = ");
+    bare = 1;
+    if (s->stmt.expr) gen_expr(out, s->stmt.expr);
+    else text_add(out, "0");
+    return 1;
+}
+
+static void emit_loop(AST *s) {
+    AST *cond = s->loop.cond;
+    if (s->type == AST_FOR) {
+        Text init = { 0 }, incr = { 0 };
+        if (!has_call(cond) && simple_assign(s->loop.init, &init) && simple_assign(s->loop.incr, &incr)) {
+            Text c = { 0 };
+            bare = 1;
+            gen_expr(&c, cond);
+            line("for (%s; %s; %s) {", init.data, c.data, incr.data);
+            emit_block(s->loop.body);
+            line("}");
+            free(c.data);
+            free(init.data);
+            free(incr.data);
+            return;
+        }
+        free(init.data);
+        free(incr.data);
+        emit_stmt(s->loop.init);
+    }
+    if (has_call(cond)) {
+        // A condicao precisa de temporarios a cada volta.
+        line("while (1) {");
+        indent++;
+        Text c = { 0 };
+        gen_expr(&c, cond);
+        line("if (!%s) break;", c.data);
+        free(c.data);
+    } else {
+        Text c = { 0 };
+        bare = 1;
+        gen_expr(&c, cond);
+        line("while (%s) {", c.data);
+        free(c.data);
+        indent++;
+    }
+    emit_stmt(s->loop.body);
+    if (s->type == AST_FOR) emit_stmt(s->loop.incr);
+    indent--;
+    line("}");
+}
+
+static void emit_stmt(AST *s) {
+    if (!s) return;
+    switch (s->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < s->list.count; i++)
+                if (s->list.items[i]->type != AST_FUNC_DECL)
+                    emit_stmt(s->list.items[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_ASSIGN: {
+            // A variavel de um DECL_ONLY ja foi declarada por collect_vars.
+            if (s->type == AST_VAR_DECL && s->op == DECL_ONLY) break;
+            Text value = { 0 };
+            if (s->op == ASSIGN_APPEND) {
+                // Os itens apos o primeiro nao leem a variavel nem chamam funcoes.
+                AST *concat = s->stmt.expr;
+                Text name = { 0 };
+                var_name(&name, s->depth, s->stmt.slot, TYPE_STRING, s->sym);
+                for (int i = 1; i < concat->list.count; i++) {
+                    value.len = 0;
+                    gen_part(&value, concat->list.items[i], 0, 1);
+                    line("%s = rt_append(%s, %s);", name.data, name.data, value.data);
+                }
+                free(name.data);
+                free(value.data);
+                break;
+            }
+            int opened = 0;
+            if (s->stmt.expr) opened = gen_stmt_expr(&value, s->stmt.expr);
+            else text_add(&value, "%s", zero(s->vtype));
+            emit_store(s, s->depth, s->stmt.slot, &value);
+            close_temps(opened);
+            free(value.data);
+            break;
+        }
+        case AST_PRINT: {
+            AST *e = s->stmt.expr;
+            Text parts = { 0 };
+            begin_temps();
+            if (e->type == AST_CONCAT) gen_parts(&parts, e->list.items, e->list.count);
+            else gen_parts(&parts, &e, 1);
+            int opened = end_temps();
+            line("rt_print(%s);", parts.data);
+            close_temps(opened);
+            free(parts.data);
+            break;
+        }
+        case AST_INPUT: {
+            Text value = { 0 };
+            if (s->vtype == TYPE_STRING) text_add(&value, "rt_read_line()");
+            else if (s->vtype == TYPE_BOOL) text_add(&value, "rt_read_int() != 0");
+            else text_add(&value, "rt_read_int()");
+            emit_store(s, s->depth, s->var.slot, &value);
+            free(value.data);
+            break;
+        }
+        case AST_RETURN: {
+            Text value = { 0 };
+            int opened = gen_stmt_expr(&value, s->stmt.expr);
+            if (in_function) {
+                line("ret = %s;", value.data);
+                line("goto out;");
+                uses_out = 1;
+            } else if (s->stmt.expr->vtype == TYPE_STRING) { // return fora de funcao e ignorado
+                line("rt_release(%s);", value.data);
+            } else {
+                line("(void)(%s);", value.data);
+            }
+            close_temps(opened);
+            free(value.data);
+            break;
+        }
+        case AST_FUNC_CALL: {
+            Text call = { 0 };
+            int opened = gen_stmt_expr(&call, s);
+            if (s->vtype == TYPE_STRING) line("rt_release(%s);", call.data);
+            else line("%s;", call.data);
+            close_temps(opened);
+            free(call.data);
+            break;
+        }
+        case AST_IF: {
+            Text c = { 0 };
+            int opened = gen_stmt_expr(&c, s->branch.cond);
+            line("if (%s) {", c.data);
+            emit_block(s->branch.then_body);
+            if (s->branch.else_body) {
+                line("} else {");
+                emit_block(s->branch.else_body);
+            }
+            line("}");
+            close_temps(opened);
+            free(c.data);
+            break;
+        }
+        case AST_WHILE:
+        case AST_FOR:
+            emit_loop(s);
+            break;
+        case AST_PARALLEL_FOR:
+            emit_loop(s->par.loop);
+            break;
+        default:
+            break;
+    }
+}
+
+// Declara as variaveis coletadas, menos as `skip` primeiras (parametros).
+static void emit_locals(int skip) {
+    for (int i = skip; i < var_count; i++) {
+        Text name = { 0 };
+        var_name(&name, vars[i].depth, vars[i].slot, vars[i].type, vars[i].sym);
+        line("%s%s = %s;", ctype(vars[i].type), name.data, zero(vars[i].type));
+        free(name.data);
+    }
+}
+
+// Solta as strings das variaveis coletadas.
+static void release_strings(void) {
+    for (int i = 0; i < var_count; i++) {
+        if (vars[i].type != TYPE_STRING) continue;
+        Text name = { 0 };
+        var_name(&name, vars[i].depth, vars[i].slot, vars[i].type, vars[i].sym);
+        line("rt_release(%s);", name.data);
+        free(name.data);
+    }
+}
+
+static void emit_signature(int index, AST *decl, const char *end) {
+    Text sig = { 0 };
+    text_add(&sig, "static %sf%d_%s(", ctype(type_from_sym(decl->func.type_sym)), index, sym_name(decl->sym));
+    for (int i = 0; i < decl->func.params_count; i++) {
+        int type = type_from_sym(decl->func.params[i].type);
+        if (i) text_add(&sig, ", ");
+        text_add(&sig, "%s", ctype(type));
+        var_name(&sig, SLOT_LOCAL, i, type, decl->func.params[i].name);
+    }
+    if (decl->func.params_count == 0) text_add(&sig, "void");
+    fprintf(body, "%s)%s\n", sig.data, end);
+    free(sig.data);
+}
+
+// Parametros e locais sao variaveis C; o `return` guarda o valor e salta
+// para o fim, onde as strings da funcao sao soltas.
+static void emit_function(int index, AST *decl) {
+    int ret_type = type_from_sym(decl->func.type_sym);
+    emit_signature(index, decl, " {");
+    indent = 1;
+    temp_count = 0;
+    in_function = 1;
+    uses_out = 0;
+    var_count = 0;
+    for (int i = 0; i < decl->func.params_count; i++)
+        add_var(SLOT_LOCAL, i, type_from_sym(decl->func.params[i].type), decl->func.params[i].name);
+    collect_vars(decl->func.body, SLOT_LOCAL, 0);
+    emit_locals(decl->func.params_count);
+    line("%sret = %s;", ctype(ret_type), zero(ret_type));
+    emit_stmt(decl->func.body);
+    if (uses_out) fprintf(body, "out:\n");
+    release_strings();
+    line("return ret;");
+    fprintf(body, "}\n\n");
+    in_function = 0;
+}
+
+static void emit_literal(FILE *out, int id, Str *s) {
+    fprintf(out, "static Str k%d = { RT_STATIC, %d, %d, \"", id, s->len, s->len);
+    for (int i = 0; i < s->len; i++) {
+        unsigned char c = (unsigned char)s->chars[i];
+        if (c == '"' || c == '\\' || c == '?') fprintf(out, "\\%c", c);
+        else if (c >= 32 && c < 127) fputc(c, out);
+        else fprintf(out, "\\%03o", c);
+    }
+    fprintf(out, "\" };\n");
+}
+
+void emit_c(AST *program, FILE *out) {
+    char *text = NULL;
+    size_t text_len = 0;
+    body = open_memstream(&text, &text_len);
+
+    int nfuncs = 0;
+    funcs = malloc(sizeof(AST*) * (program->list.count + 1));
+    for (int i = 0; i < program->list.count; i++)
+        if (program->list.items[i]->type == AST_FUNC_DECL)
+            funcs[nfuncs++] = program->list.items[i];
+
+    // Globais
+    var_count = 0;
+    collect_vars(program, SLOT_GLOBAL, 1);
+    for (int i = 0; i < var_count; i++) {
+        Text name = { 0 };
+        var_name(&name, SLOT_GLOBAL, vars[i].slot, vars[i].type, vars[i].sym);
+        fprintf(body, "static %s%s = %s;\n", ctype(vars[i].type), name.data, zero(vars[i].type));
+        free(name.data);
+    }
+    if (var_count) fputc('\n', body);
+
+    for (int i = 0; i < nfuncs; i++)
+        emit_signature(i, funcs[i], ";");
+    if (nfuncs) fputc('\n', body);
+    for (int i = 0; i < nfuncs; i++)
+        emit_function(i, funcs[i]);
+
+    // Codigo de topo: os locais sao os dos `for` fora de funcoes.
+    fprintf(body, "int main(void) {\n");
+    indent = 1;
+    temp_count = 0;
+    var_count = 0;
+    collect_vars(program, SLOT_LOCAL, 0);
+    emit_locals(0);
+    emit_stmt(program);
+    release_strings();
+    var_count = 0;
+    collect_vars(program, SLOT_GLOBAL, 1);
+    release_strings();
+    line("rt_flush();");
+    line("return 0;");
+    fprintf(body, "}\n");
+    fclose(body);
+
+    fprintf(out, "// Gerado por macslang --emit-c. Compile com: cc -O2 -fwrapv prog.c\n");
+    fputs(runtime, out);
+    fputc('\n', out);
+    for (int i = 0; i < literal_count; i++)
+        emit_literal(out, i, literals[i]);
+    if (literal_count) fputc('\n', out);
+    fwrite(text, 1, text_len, out);
+
+    free(text);
+    free(funcs);
+    free(literals);
+    free(vars);
+    funcs = NULL;
+    literals = NULL;
+    vars = NULL;
+    literal_count = literal_cap = var_count = var_cap = 0;
+}
+
+int emit_c_build(AST *program, const char *binary) {
+    const char *cc = getenv("CC");
+    if (!cc || !*cc) cc = "cc";
+    // O caminho vai entre aspas simples para o shell do popen.
+    Text cmd = { 0 };
+    text_add(&cmd, "%s -O2 -fwrapv -x c -o '", cc);
+    for (const char *p = binary; *p; p++) {
+        if (*p == '\'') text_add(&cmd, "'\\''");
+        else text_add(&cmd, "%c", *p);
+    }
+    text_add(&cmd, "' -");
+    FILE *pipe = popen(cmd.data, "w");
+    free(cmd.data);
+    if (!pipe) return 1;
+    emit_c(program, pipe);
+    return pclose(pipe) == 0 ? 0 : 1;
+}
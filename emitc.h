@@ -0,0 +1,17 @@
+#ifndef EMITC_H
+#define EMITC_H
+#include <stdio.h>
+#include "parser.h"
+
+// Backend C (--emit-c, --build): traduz o programa, ja verificado e resolvido,
+// para um programa C autonomo. Funcoes viram funcoes C, `for`/`while` viram
+// lacos C e int/bool viram `int`; strings e I/O usam um runtime pequeno
+// emitido no inicio do arquivo, com a mesma semantica do interpretador.
+// `parallel for` e spawn rodam em sequencia (um task e o seu resultado int).
+void emit_c(AST *program, FILE *out);
+
+// Emite o C e compila com o cc local ($CC, se definido) em `binary`;
+// devolve 0 se o compilador terminou sem erro.
+int emit_c_build(AST *program, const char *binary);
+
+#endif
@@ -0,0 +1,36 @@
+#include "errors.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+_Thread_local ErrorTrap *error_trap;
+
+void error_vprintf(const char *fmt, va_list ap) {
+    ErrorTrap *t = error_trap;
+    if (!t) {
+        vprintf(fmt, ap);
+        return;
+    }
+    va_list copy;
+    va_copy(copy, ap);
+    int n = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    if (n < 0) return;
+    if (t->len + (size_t)n + 1 > t->cap) {
+        while (t->len + (size_t)n + 1 > t->cap) t->cap = t->cap ? t->cap * 2 : 256;
+        t->text = realloc(t->text, t->cap);
+    }
+    vsnprintf(t->text + t->len, t->cap - t->len, fmt, ap);
+    t->len += (size_t)n;
+}
+
+void error_printf(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    error_vprintf(fmt, ap);
+    va_end(ap);
+}
+
+_Noreturn void error_exit(void) {
+    if (error_trap) longjmp(error_trap->jump, 1);
+    exit(1);
+}
@@ -0,0 +1,24 @@
+#ifndef ERRORS_H
+#define ERRORS_H
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+// Erros de analise (lexer, parser, tipos, resolucao). Sem armadilha ativa as
+// mensagens vao para stdout e error_exit encerra o processo, como sempre na
+// linha de comando. Durante a carga de um MacsContext (macslang.h) ha uma
+// armadilha: as mensagens sao acumuladas nela e error_exit volta ao setjmp
+// da carga, sem derrubar o processo que embute a linguagem.
+typedef struct {
+    jmp_buf jump;
+    char *text;         // mensagens acumuladas (malloc, terminadas em NUL)
+    size_t len, cap;
+} ErrorTrap;
+
+extern _Thread_local ErrorTrap *error_trap;
+
+void error_printf(const char *fmt, ...);
+void error_vprintf(const char *fmt, va_list ap);
+_Noreturn void error_exit(void);
+
+#endif
@@ -1,392 +1,715 @@
 #include "interpreter.h"
+#include "jit.h"
+#include "memo.h"
+#include "pool.h"
+#include "profile.h"
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static void exec(AST *ast);
-
-typedef struct Var {
-    char name[64];
-    Value value;
-    struct Var *next;
-} Var;
-
-typedef struct Scope {
-    Var *vars;
-    struct Scope *prev;
-} Scope;
-
-static Scope *current_scope = NULL;
-
-void init_vars(void) {
-    while (current_scope) {
-        Var *v = current_scope->vars;
-        while (v) {
-            if (v->value.type == VAL_STRING && v->value.str_val)
-                free(v->value.str_val);
-            Var *next = v->next;
-            free(v);
-            v = next;
-        }
-        Scope *prev = current_scope->prev;
-        free(current_scope);
-        current_scope = prev;
-    }
-    current_scope = malloc(sizeof(Scope));
-    current_scope->vars = NULL;
-    current_scope->prev = NULL;
-}
-
-static void push_scope() {
-    Scope *s = malloc(sizeof(Scope));
-    s->vars = NULL;
-    s->prev = current_scope;
-    current_scope = s;
-}
-
-static void pop_scope() {
-    Var *v = current_scope->vars;
-    while (v) {
-        if (v->value.type == VAL_STRING && v->value.str_val)
-            free(v->value.str_val);
-        Var *next = v->next;
-        free(v);
-        v = next;
-    }
-    Scope *prev = current_scope->prev;
-    free(current_scope);
-    current_scope = prev;
-}
-
-static Var* find_var(const char *name) {
-    Scope *s = current_scope;
-    while (s) {
-        Var *v = s->vars;
-        while (v) {
-            if (strcmp(v->name, name) == 0)
-                return v;
-            v = v->next;
-        }
-        s = s->prev;
-    }
-    return NULL;
-}
-
-static void set_var(const char *name, Value v) {
-    Var *var = find_var(name);
-    if (!var) {
-        var = calloc(1, sizeof(Var));
-        strncpy(var->name, name, 63);
-        var->name[63] = '\0';
-        var->next = current_scope->vars;
-        current_scope->vars = var;
-    } else {
-        if (var->value.type == VAL_STRING && var->value.str_val)
-            free(var->value.str_val);
-    }
-    var->value = v;
-    if (v.type == VAL_STRING && v.str_val)
-        var->value.str_val = strdup(v.str_val); 
-}
+// Resultado de executar um comando: segue para o proximo ou a funcao retornou
+// (o valor de retorno fica no Value* passado a exec).
+typedef enum {
+    EXEC_NEXT,
+    EXEC_RETURN
+} ExecStatus;
 
-static void assign_var(const char *name, Value v) {
-    Var *var = find_var(name);
-    if (!var) {
-        printf("Undefined variable: %s\n", name);
-        exit(1);
-    }
-    if (var->value.type == VAL_STRING && var->value.str_val)
-        free(var->value.str_val);
-    var->value = v;
-    if (v.type == VAL_STRING && v.str_val)
-        var->value.str_val = strdup(v.str_val);
-}
-typedef struct Func {
-    char name[64];
+static ExecStatus exec(Interp *in, AST *ast, Value *ret);
+
+// Funcoes na ordem de declaracao; as chamadas ja chegam ligadas pelo resolve
+// (list.index) e com a aridade verificada.
+typedef struct {
     int param_count;
-    char param_names[8][64];
-    char param_types[8][16];
-    char return_type[16];
-    AST* block;
-    struct Func* next;
+    int locals;
+    AST *block;
 } Func;
 
-static Func* funcs = NULL;
+// Estado de execucao de um programa, passado a todas as funcoes do motor:
+// nada aqui e global, entao interpretadores diferentes rodam em threads
+// diferentes sem travas (macslang.h). Variaveis vivem em vetores planos: o
+// resolve da a cada acesso (depth, slot), entao ler ou escrever e um indice
+// no frame atual ou nas globais. Os frames ficam empilhados num unico vetor
+// que cresce conforme a recursao; como ele pode ser realocado, o frame atual
+// e guardado como indice.
+struct Interp {
+    Value *globals;
+    int global_count;
+    Value *stack;
+    int stack_top, stack_cap;
+    int frame_base;         // inicio do frame da funcao em execucao
+    int call_depth;
+    Func *funcs;
+    int func_count;
+    int quicken, jit, memo; // recursos ligados para este programa
+    int profile;            // profile_enabled
+    int threads;            // parallel_threads
+    Pool *pool;             // criado no primeiro parallel for ou spawn; compartilhado
+    int owns_pool;          // com os Interp dos pedacos e tarefas, que nao o liberam
+    Interp *root;           // o Interp do programa, que vive mais que as tarefas
+    atomic_int tasks;       // no root: tarefas de spawn ainda nao terminadas
+};
 
-static void add_func(const char* name, int param_count, char param_names[][64], char param_types[][16], const char* ret_type, AST* block) {
-    Func* f = calloc(1, sizeof(Func));
-    strcpy(f->name, name);
-    f->param_count = param_count;
-    for (int i = 0; i < param_count; i++) {
-        strcpy(f->param_names[i], param_names[i]);
-        strcpy(f->param_types[i], param_types[i]);
-    }
-    strcpy(f->return_type, ret_type);
-    f->block = block;
-    f->next = funcs;
-    funcs = f;
-}
-
-static Func* find_func(const char* name) {
-    Func* f = funcs;
-    while (f) {
-        if (strcmp(f->name, name) == 0)
-            return f;
-        f = f->next;
-    }
-    return NULL;
+static void ensure_stack(Interp *in, int needed) {
+    if (in->stack_top + needed <= in->stack_cap) return;
+    while (in->stack_top + needed > in->stack_cap)
+        in->stack_cap = in->stack_cap ? in->stack_cap * 2 : 256;
+    in->stack = realloc(in->stack, sizeof(Value) * in->stack_cap);
 }
 
-typedef struct {
-    int is_returning;
-    Value value;
-} ReturnValue;
+// Empilha `size` slots vazios; devolve o primeiro.
+static int push_slots(Interp *in, int size) {
+    ensure_stack(in, size);
+    int base = in->stack_top;
+    for (int i = 0; i < size; i++) in->stack[in->stack_top++] = value_none();
+    return base;
+}
 
-static ReturnValue ret_val;
+// Libera os slots a partir de `base`, desempilhando-os.
+static void pop_slots(Interp *in, int base) {
+    while (in->stack_top > base) value_free(in->stack[--in->stack_top]);
+}
 
-static Value eval_expr(AST* ast);
+static inline Value *var_ref(Interp *in, AST *ast, int slot) {
+    return ast->depth == SLOT_LOCAL ? &in->stack[in->frame_base + slot] : &in->globals[slot];
+}
 
-static Value value_int(int v) {
-    Value val = { VAL_INT };
-    val.int_val = v;
-    return val;
+// Guarda `v` no slot, liberando o valor anterior; consome `v`.
+static inline void store_var(Value *var, Value v) {
+    value_free(*var);
+    *var = v;
 }
-static Value value_bool(int v) {
-    Value val = { VAL_BOOL };
-    val.bool_val = !!v;
-    return val;
+
+static Value eval_expr(Interp *in, AST* ast);
+static Value spawn_task(Interp *in, AST *ast);
+static Value await_task(Interp *in, AST *ast);
+
+_Thread_local int quicken_enabled = 1;
+_Thread_local int parallel_threads;
+
+// Avalia os itens de um AST_CONCAT; ate CONCAT_INLINE cabem em `inline_parts`
+// (na pilha de C), acima disso o vetor vem do heap.
+#define CONCAT_INLINE 16
+
+// Cada chamada do programa passa por exec e eval_expr, entao o quadro deles
+// limita a profundidade da recursao: os casos com vetores na pilha ficam em
+// funcoes proprias, fora deles.
+#define OUT_OF_LINE __attribute__((noinline))
+
+static Value *eval_parts(Interp *in, AST *concat, Value *inline_parts) {
+    int n = concat->list.count;
+    Value *parts = n <= CONCAT_INLINE ? inline_parts : malloc(sizeof(Value) * n);
+    for (int i = 0; i < n; i++) parts[i] = eval_expr(in, concat->list.items[i]);
+    return parts;
 }
-static Value value_string(const char* s) {
-    Value val = { VAL_STRING };
-    val.str_val = s ? strdup(s) : strdup("");
-    return val;
+
+static OUT_OF_LINE Value eval_concat(Interp *in, AST *concat) {
+    Value inline_parts[CONCAT_INLINE];
+    Value *parts = eval_parts(in, concat, inline_parts);
+    Value v = value_concat(parts, concat->list.count);
+    if (parts != inline_parts) free(parts);
+    return v;
 }
 
-static Value value_none() {
-    Value val = { VAL_NONE };
-    return val;
+// print de um AST_CONCAT: as partes vao direto para a saida.
+static OUT_OF_LINE void print_concat(Interp *in, AST *concat) {
+    Value inline_parts[CONCAT_INLINE];
+    Value *parts = eval_parts(in, concat, inline_parts);
+    value_print_parts(parts, concat->list.count);
+    if (parts != inline_parts) free(parts);
 }
 
-static int is_truthy(Value v) {
-    if (v.type == VAL_BOOL) return v.bool_val;
-    if (v.type == VAL_INT) return v.int_val != 0;
-    if (v.type == VAL_STRING) return v.str_val && v.str_val[0] != '\0';
-    return 0;
+// Funcao so de int/bool ja compilada: argumentos nao precisam ser liberados.
+static OUT_OF_LINE Value call_native(Interp *in, AST *ast, JitEntry native, int index) {
+    Value inline_args[16] = { { 0 } };
+    int n = ast->list.count;
+    Value *args = n <= 16 ? inline_args : malloc(sizeof(Value) * n);
+    for (int i = 0; i < n; i++) args[i] = eval_expr(in, ast->list.items[i]);
+    Value v = jit_call(native, index, args, n);
+    if (args != inline_args) free(args);
+    return v;
 }
 
-static Value eval_expr(AST* ast) {
-    if (!ast) return value_none();
-    if (ast->type == AST_LITERAL && ast->str_value[0])
-        return value_string(ast->str_value);
-    if (ast->type == AST_LITERAL)
-        return value_int(ast->int_value);
-    if (ast->type == AST_IDENTIFIER) {
-        Var* v = find_var(ast->name);
-        if (!v) { printf("Undefined variable: %s\n", ast->name); exit(1);}
-        if (v->value.type == VAL_STRING)
-            return value_string(v->value.str_val);
-        else if (v->value.type == VAL_INT)
-            return value_int(v->value.int_val);
-        else if (v->value.type == VAL_BOOL)
-            return value_bool(v->value.bool_val);
-        return value_none();
+// Chamada a funcao `index` com os argumentos de `ast`, sem passar pelo JIT.
+static Value call_func(Interp *in, AST *ast, int index, int memo) {
+    Func *f = &in->funcs[index];
+    // Os argumentos sao avaliados no frame de quem chama e empilhados
+    // direto nos primeiros slots do frame novo.
+    int base = in->stack_top;
+    for (int i = 0; i < f->param_count; i++) {
+        Value arg = eval_expr(in, ast->list.items[i]);
+        ensure_stack(in, 1);
+        in->stack[in->stack_top++] = arg;
     }
-    if (ast->type == AST_BINOP) {
-        Value left = eval_expr(ast->left);
-        Value right = eval_expr(ast->right);
-        if ((left.type == VAL_STRING) || (right.type == VAL_STRING)) {
-            const char *lstr = (left.type == VAL_STRING) ? left.str_val : "";
-            char ltmp[64]; if (left.type == VAL_INT) sprintf(ltmp, "%d", left.int_val);
-            char lbool[8]; if (left.type == VAL_BOOL) sprintf(lbool, "%s", left.bool_val ? "true" : "false");
-            if (left.type == VAL_INT) lstr = ltmp;
-            if (left.type == VAL_BOOL) lstr = lbool;
-            const char *rstr = (right.type == VAL_STRING) ? right.str_val : "";
-            char rtmp[64]; if (right.type == VAL_INT) sprintf(rtmp, "%d", right.int_val);
-            char rbool[8]; if (right.type == VAL_BOOL) sprintf(rbool, "%s", right.bool_val ? "true" : "false");
-            if (right.type == VAL_INT) rstr = rtmp;
-            if (right.type == VAL_BOOL) rstr = rbool;
-            size_t len = strlen(lstr) + strlen(rstr) + 1;
-            char *buf = malloc(len);
-            strcpy(buf, lstr);
-            strcat(buf, rstr);
-            if (left.type == VAL_STRING) free(left.str_val);
-            if (right.type == VAL_STRING) free(right.str_val);
-            Value v = value_string(buf);
-            free(buf); 
-            return v;
+    if (in->profile) profile_call(index);
+    if (memo) {
+        Value cached;
+        if (memo_lookup(index, &in->stack[base], &cached)) {
+            pop_slots(in, base);
+            if (in->profile) profile_return();
+            return cached;
         }
-        int l = (left.type == VAL_INT) ? left.int_val : 0;
-        int r = (right.type == VAL_INT) ? right.int_val : 0;
-        int res = 0;
-        if (strcmp(ast->name, "+") == 0) res = l + r;
-        else if (strcmp(ast->name, "-") == 0) res = l - r;
-        else if (strcmp(ast->name, "*") == 0) res = l * r;
-        else if (strcmp(ast->name, "/") == 0) res = r != 0 ? l / r : 0;
-        else if (strcmp(ast->name, "%") == 0) res = r != 0 ? l % r : 0;
-        else if (strcmp(ast->name, "<") == 0) return value_bool(l < r);
-        else if (strcmp(ast->name, "<=") == 0) return value_bool(l <= r);
-        else if (strcmp(ast->name, ">") == 0) return value_bool(l > r);
-        else if (strcmp(ast->name, ">=") == 0) return value_bool(l >= r);
-        else if (strcmp(ast->name, "==") == 0) return value_bool(l == r);
-        else if (strcmp(ast->name, "!=") == 0) return value_bool(l != r);
-        if (left.type == VAL_STRING) free(left.str_val);
-        if (right.type == VAL_STRING) free(right.str_val);
-        return value_int(res);
     }
-    if (ast->type == AST_FUNC_CALL) {
-        Func* f = find_func(ast->name);
-        if (!f) { printf("Undefined function: %s\n", ast->name); exit(1); }
-        push_scope();
-        for (int i = 0; i < f->param_count; i++) {
-            Value argval = eval_expr(ast->children[i]);
-            set_var(f->param_names[i], argval);
+    push_slots(in, f->locals - f->param_count);
+    int caller = in->frame_base;
+    in->frame_base = base;
+    in->call_depth++;
+    Value ret = value_none();
+    exec(in, f->block, &ret);
+    in->call_depth--;
+    in->frame_base = caller;
+    pop_slots(in, base);
+    if (memo) memo_finish(index, ret);
+    if (in->profile) profile_return();
+    return ret;
+}
+
+// Primeira execucao de um AST_BINOP: escolhe a variante pelos tipos que os
+// operandos tem agora. Se depois eles mudarem (por exemplo o "none" de uma
+// funcao que termina sem return), a variante vira AST_Q_BINOP de vez.
+static Value quicken_binop(Interp *in, AST *ast) {
+    Value left = eval_expr(in, ast->bin.left);
+    Value right = eval_expr(in, ast->bin.right);
+    if (left.type == VAL_INT && right.type == VAL_INT)
+        ast->type = AST_Q_ADD_INT + ast->op;
+    else if (ast->op == OP_ADD && (left.type == VAL_STRING || right.type == VAL_STRING))
+        ast->type = AST_Q_ADD_STR;
+    else
+        ast->type = AST_Q_BINOP;
+    return value_binop(ast->op, left, right);
+}
+
+static Value eval_expr(Interp *in, AST* ast) {
+    if (!ast) return value_none();
+    switch (ast->type) {
+        case AST_LITERAL:
+            if (ast->vtype == TYPE_STRING) return value_str(ast->lit.str_value);
+            if (ast->vtype == TYPE_BOOL) return value_bool(ast->lit.int_value);
+            return value_int(ast->lit.int_value);
+        case AST_Q_LOCAL:
+            return value_copy(in->stack[in->frame_base + ast->var.slot]);
+        case AST_Q_GLOBAL:
+            return value_copy(in->globals[ast->var.slot]);
+        case AST_IDENTIFIER:
+            if (in->quicken) ast->type = ast->depth == SLOT_LOCAL ? AST_Q_LOCAL : AST_Q_GLOBAL;
+            return value_copy(*var_ref(in, ast, ast->var.slot));
+
+#define QUICK_INT(kind, expr, make) \
+        case kind: { \
+            Value l = eval_expr(in, ast->bin.left), r = eval_expr(in, ast->bin.right); \
+            if (l.type == VAL_INT && r.type == VAL_INT) { \
+                int a = l.int_val, b = r.int_val; \
+                return make(expr); \
+            } \
+            if (in->quicken) ast->type = AST_Q_BINOP; \
+            return value_binop(ast->op, l, r); \
         }
-        ret_val.is_returning = 0;
-        ret_val.value = value_none();
-        for (int i = 0; i < f->block->children_count; i++) {
-            exec(f->block->children[i]);
-            if (ret_val.is_returning)
-                break;
+        QUICK_INT(AST_Q_ADD_INT, int_add(a, b), value_int)
+        QUICK_INT(AST_Q_SUB_INT, int_sub(a, b), value_int)
+        QUICK_INT(AST_Q_MUL_INT, int_mul(a, b), value_int)
+        QUICK_INT(AST_Q_DIV_INT, int_div(a, b), value_int)
+        QUICK_INT(AST_Q_MOD_INT, int_mod(a, b), value_int)
+        QUICK_INT(AST_Q_EQ_INT, a == b, value_bool)
+        QUICK_INT(AST_Q_NEQ_INT, a != b, value_bool)
+        QUICK_INT(AST_Q_LT_INT, a < b, value_bool)
+        QUICK_INT(AST_Q_LTE_INT, a <= b, value_bool)
+        QUICK_INT(AST_Q_GT_INT, a > b, value_bool)
+        QUICK_INT(AST_Q_GTE_INT, a >= b, value_bool)
+#undef QUICK_INT
+        case AST_Q_ADD_STR: {
+            Value parts[2];
+            parts[0] = eval_expr(in, ast->bin.left);
+            parts[1] = eval_expr(in, ast->bin.right);
+            if (parts[0].type == VAL_STRING || parts[1].type == VAL_STRING) return value_concat(parts, 2);
+            if (in->quicken) ast->type = AST_Q_BINOP;
+            return value_binop(OP_ADD, parts[0], parts[1]);
         }
-        Value ret = ret_val.value;
-        pop_scope();
-        return ret;
-    }
-    return value_none();
-}
-static void exec(AST *ast);
-
-void interpret(AST *ast) {
-    push_scope();
-    if (ast && ast->type == AST_PROGRAM) {
-        for (int i = 0; i < ast->children_count; i++) {
-            AST *stmt = ast->children[i];
-            if (stmt->type == AST_FUNC_DECL) {
-                int paramc = stmt->params_count;
-                char param_names[8][64];
-                char param_types[8][16];
-                for (int j = 0; j < paramc; j++) {
-                    strncpy(param_names[j], stmt->params[j].name, 63);
-                    param_names[j][63] = 0;
-                    strncpy(param_types[j], stmt->params[j].type, 15);
-                    param_types[j][15] = 0;
+        case AST_Q_BINOP: {
+            Value left = eval_expr(in, ast->bin.left);
+            Value right = eval_expr(in, ast->bin.right);
+            return value_binop(ast->op, left, right);
+        }
+        case AST_BINOP: {
+            if (in->quicken) return quicken_binop(in, ast);
+            // Operandos provados int pelo typecheck: sem checagem de string nem sprintf.
+            if (ast->bin.left->vtype == TYPE_INT && ast->bin.right->vtype == TYPE_INT) {
+                int l = eval_expr(in, ast->bin.left).int_val;
+                int r = eval_expr(in, ast->bin.right).int_val;
+                switch (ast->op) {
+                    case OP_ADD: return value_int(int_add(l, r));
+                    case OP_SUB: return value_int(int_sub(l, r));
+                    case OP_MUL: return value_int(int_mul(l, r));
+                    case OP_DIV: return value_int(int_div(l, r));
+                    case OP_MOD: return value_int(int_mod(l, r));
+                    case OP_EQ: return value_bool(l == r);
+                    case OP_NEQ: return value_bool(l != r);
+                    case OP_LT: return value_bool(l < r);
+                    case OP_LTE: return value_bool(l <= r);
+                    case OP_GT: return value_bool(l > r);
+                    case OP_GTE: return value_bool(l >= r);
                 }
-                add_func(stmt->name, paramc, param_names, param_types, stmt->str_value, stmt->body);
             }
+            Value left = eval_expr(in, ast->bin.left);
+            Value right = eval_expr(in, ast->bin.right);
+            return value_binop(ast->op, left, right);
+        }
+        case AST_CONCAT:
+            return eval_concat(in, ast);
+        case AST_Q_CALL:
+            return call_func(in, ast, ast->list.index, 0);
+        case AST_FUNC_CALL: {
+            int index = ast->list.index;
+            int memo = in->memo && memo_active(index);
+            if (in->jit && !memo) {
+                JitEntry native = jit_hot(index);
+                if (native) return call_native(in, ast, native, index);
+            } else if (in->quicken && !memo) {
+                // Sem JIT e sem cache (que nunca liga depois): chamada direta.
+                ast->type = AST_Q_CALL;
+            }
+            return call_func(in, ast, index, memo);
+        }
+        case AST_SPAWN:
+            return spawn_task(in, ast);
+        case AST_AWAIT:
+            return await_task(in, ast);
+        default:
+            return value_none();
+    }
+}
+
+Interp *interp_new(AST *program, Frames frames) {
+    Interp *in = calloc(1, sizeof(Interp));
+    in->globals = malloc(sizeof(Value) * (frames.globals + 1));
+    in->global_count = frames.globals;
+    for (int i = 0; i < in->global_count; i++) in->globals[i] = value_none();
+    in->frame_base = push_slots(in, frames.main_locals);
+    in->funcs = malloc(sizeof(Func) * (program->list.count + 1));
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type != AST_FUNC_DECL) continue;
+        Func *f = &in->funcs[in->func_count++];
+        f->param_count = stmt->func.params_count;
+        f->locals = stmt->func.locals;
+        f->block = stmt->func.body;
+    }
+    in->quicken = quicken_enabled;
+    in->jit = jit_enabled;
+    in->memo = 1;
+    in->profile = profile_enabled;
+    in->threads = parallel_threads;
+    in->root = in;
+    atomic_init(&in->tasks, 0);
+    return in;
+}
+
+void interp_run(Interp *in, AST *program) {
+    Value ret = value_none();
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type == AST_FUNC_DECL) continue;
+        if (in->profile) profile_enter(stmt);
+        exec(in, stmt, &ret);
+        if (in->profile) profile_exit();
+    }
+}
+
+Value interp_call(Interp *in, int index, const Value *args) {
+    Func *f = &in->funcs[index];
+    int base = in->stack_top;
+    ensure_stack(in, f->param_count);
+    for (int i = 0; i < f->param_count; i++) in->stack[in->stack_top++] = value_copy(args[i]);
+    if (in->profile) profile_call(index);
+    push_slots(in, f->locals - f->param_count);
+    int caller = in->frame_base;
+    in->frame_base = base;
+    in->call_depth++;
+    Value ret = value_none();
+    exec(in, f->block, &ret);
+    in->call_depth--;
+    in->frame_base = caller;
+    pop_slots(in, base);
+    if (in->profile) profile_return();
+    return ret;
+}
+
+void interp_set_memo(Interp *in, int on) {
+    in->memo = on;
+}
+
+void interp_free(Interp *in) {
+    // Tarefas que ninguem esperou terminam antes de o pool sair.
+    if (in->owns_pool)
+        while (atomic_load_explicit(&in->tasks, memory_order_acquire) > 0)
+            if (!pool_help(in->pool)) sched_yield();
+    pop_slots(in, 0);
+    for (int i = 0; i < in->global_count; i++) value_free(in->globals[i]);
+    free(in->globals);
+    free(in->stack);
+    free(in->funcs);
+    if (in->owns_pool) pool_free(in->pool);
+    free(in);
+}
+
+void interpret(AST *ast, Frames frames) {
+    Interp *in = interp_new(ast, frames);
+    interp_run(in, ast);
+    interp_free(in);
+}
+
+// Condicao de if/while/for.
+static int eval_cond(Interp *in, AST *cond) {
+    Value v = eval_expr(in, cond);
+    int is_true = is_truthy(v);
+    value_free(v);
+    return is_true;
+}
+
+// `for` marcado FOR_COUNTED pelo passe de lacos: i (local int) so muda no
+// incremento `i = i +/- c` e o limite e um literal ou local que o laco nao
+// escreve, entao a condicao compara dois ints sem passar por eval_expr.
+static ExecStatus exec_counted(Interp *in, AST *ast, Value *ret) {
+    AST *cond = ast->loop.cond, *incr = ast->loop.incr;
+    AST *step = incr->stmt.expr, *bound = cond->bin.right;
+    int slot = incr->stmt.slot;
+    exec(in, ast->loop.init, ret);
+    Value b = bound->type == AST_LITERAL ? value_int(bound->lit.int_value) : in->stack[in->frame_base + bound->var.slot];
+    if (b.type != VAL_INT || in->stack[in->frame_base + slot].type != VAL_INT) {
+        while (eval_cond(in, cond)) {
+            if (exec(in, ast->loop.body, ret) == EXEC_RETURN) return EXEC_RETURN;
+            exec(in, incr, ret);
         }
+        return EXEC_NEXT;
     }
-    for (int i = 0; i < ast->children_count; i++) {
-        AST *stmt = ast->children[i];
-        if (stmt->type != AST_FUNC_DECL)
-            exec(stmt);
+    int limit = b.int_val;
+    unsigned int delta = (unsigned int)step->bin.right->lit.int_value;
+    if (step->op == OP_SUB) delta = 0u - delta;
+    for (;;) {
+        // O corpo pode chamar funcoes e realocar a pilha: rele o slot.
+        int i = in->stack[in->frame_base + slot].int_val;
+        int go;
+        switch (cond->op) {
+            case OP_LT: go = i < limit; break;
+            case OP_LTE: go = i <= limit; break;
+            case OP_GT: go = i > limit; break;
+            case OP_GTE: go = i >= limit; break;
+            default: go = i != limit; break;
+        }
+        if (!go) break;
+        if (exec(in, ast->loop.body, ret) == EXEC_RETURN) return EXEC_RETURN;
+        i = in->stack[in->frame_base + slot].int_val;
+        in->stack[in->frame_base + slot] = value_int((int)((unsigned int)i + delta));
     }
-    pop_scope();
+    return EXEC_NEXT;
 }
 
-static void exec(AST *ast) {
-    if (!ast) return;
+// O pool e criado pela thread do programa, no primeiro uso; os Interp de
+// pedacos e tarefas ja nascem com ele.
+static Pool *interp_pool(Interp *in) {
+    if (!in->pool) {
+        in->pool = pool_new(in->threads);
+        in->owns_pool = 1;
+    }
+    return in->pool;
+}
+
+// Voltas de `i = start; i <op> limit; i += delta` (check_parallel ja exigiu
+// delta > 0 com < e <=, delta < 0 com > e >=).
+static long long trip_count(int start, int delta, int op, int limit) {
+    long long s = start, l = limit, d = delta;
+    switch (op) {
+        case OP_LT: return s < l ? (l - s + d - 1) / d : 0;
+        case OP_LTE: return s <= l ? (l - s) / d + 1 : 0;
+        case OP_GT: return s > l ? (s - l - d - 1) / -d : 0;
+        default: return s >= l ? (s - l) / -d + 1 : 0;
+    }
+}
+
+// Copia valores para o escopo privado de um pedaco. O corpo nao usa strings
+// (check_parallel), entao elas viram vazias: nenhuma contagem de referencia
+// nao atomica e tocada por duas threads.
+static void copy_private(Value *dst, const Value *src, int n) {
+    for (int i = 0; i < n; i++)
+        dst[i] = src[i].type == VAL_STRING ? value_none() : value_copy(src[i]);
+}
+
+// Um pedaco [lo, hi) das voltas de um parallel for.
+typedef struct {
+    Task task;
+    Interp *parent;
+    AST *par;
+    long long lo, hi;
+    int start, delta;
+    int partial;            // soma do pedaco na variavel de reduce
+    atomic_int *pending;
+} Chunk;
+
+static void run_chunk(Task *task) {
+    Chunk *c = (Chunk*)task;
+    Interp *p = c->parent;
+    AST *loop = c->par->par.loop, *reduce = c->par->par.reduce;
+    int slot = loop->loop.incr->stmt.slot;
+
+    // Escopo privado: copia das globais e do frame atual. So a variavel de
+    // reduce e as declaradas no corpo sao escritas, e cada pedaco tem as suas.
+    // Sem quickening (os nos sao compartilhados), JIT nem memo.
+    Interp w = { 0 };
+    w.global_count = p->global_count;
+    w.globals = malloc(sizeof(Value) * (p->global_count + 1));
+    copy_private(w.globals, p->globals, p->global_count);
+    int frame = p->stack_top - p->frame_base;
+    ensure_stack(&w, frame);
+    copy_private(w.stack, p->stack + p->frame_base, frame);
+    w.stack_top = frame;
+    w.call_depth = p->call_depth;
+    w.funcs = p->funcs;
+    w.func_count = p->func_count;
+    w.threads = p->threads;
+    w.pool = p->pool;
+    w.root = p->root;
+    if (reduce) *var_ref(&w, reduce, reduce->var.slot) = value_int(0);
+
+    Value ret = value_none();
+    for (long long k = c->lo; k < c->hi; k++) {
+        w.stack[slot] = value_int((int)((unsigned int)c->start + (unsigned int)(k * c->delta)));
+        exec(&w, loop->loop.body, &ret);
+    }
+    c->partial = reduce ? var_ref(&w, reduce, reduce->var.slot)->int_val : 0;
+
+    pop_slots(&w, 0);
+    for (int i = 0; i < w.global_count; i++) value_free(w.globals[i]);
+    free(w.globals);
+    free(w.stack);
+    atomic_fetch_sub_explicit(c->pending, 1, memory_order_release);
+}
+
+// parallel for: a primeira volta roda aqui mesmo (e especializa os nos do
+// corpo); as demais sao divididas em pedacos no pool, e as somas parciais
+// entram na variavel de reduce na ordem dos pedacos.
+static ExecStatus exec_parallel(Interp *in, AST *ast, Value *ret) {
+    AST *loop = ast->par.loop, *reduce = ast->par.reduce;
+    if (in->threads <= 1) return exec(in, loop, ret);
+
+    AST *incr = loop->loop.incr, *cond = loop->loop.cond, *step = incr->stmt.expr;
+    int slot = incr->stmt.slot;
+    exec(in, loop->loop.init, ret);
+    int start = in->stack[in->frame_base + slot].int_val;
+    int delta = step->bin.right->lit.int_value;
+    if (step->op == OP_SUB) delta = (int)(0u - (unsigned int)delta);
+    Value limit = eval_expr(in, cond->bin.right);
+    long long n = trip_count(start, delta, cond->op, limit.int_val);
+    if (n == 0) return EXEC_NEXT;
+
+    exec(in, loop->loop.body, ret);
+    if (n > 1) {
+        Pool *pool = interp_pool(in);
+        long long rest = n - 1;
+        int count = in->threads * 4;
+        if (count > rest) count = (int)rest;
+        Chunk *chunks = malloc(sizeof(Chunk) * count);
+        atomic_int pending;
+        atomic_init(&pending, count);
+        for (int i = 0; i < count; i++) {
+            Chunk *c = &chunks[i];
+            c->task.run = run_chunk;
+            c->parent = in;
+            c->par = ast;
+            c->lo = 1 + rest * i / count;
+            c->hi = 1 + rest * (i + 1) / count;
+            c->start = start;
+            c->delta = delta;
+            c->pending = &pending;
+            pool_push(pool, &c->task);
+        }
+        while (atomic_load_explicit(&pending, memory_order_acquire) > 0)
+            if (!pool_help(pool)) sched_yield();
+        if (reduce) {
+            Value *r = var_ref(in, reduce, reduce->var.slot);
+            unsigned int sum = (unsigned int)r->int_val;
+            for (int i = 0; i < count; i++) sum += (unsigned int)chunks[i].partial;
+            *r = value_int((int)sum);
+        }
+        free(chunks);
+    }
+    // Como em sequencia, i termina no primeiro valor que falha a condicao.
+    in->stack[in->frame_base + slot] = value_int((int)((unsigned int)start + (unsigned int)(n * delta)));
+    return EXEC_NEXT;
+}
+
+// Tarefa de spawn: a funcao `index` roda num Interp proprio em algum
+// trabalhador do pool. Uma referencia e do handle (VAL_TASK) e outra da
+// propria tarefa ate ela terminar.
+struct Handle {
+    Task task;
+    Interp *root;
+    int index;
+    Value result;           // int, valido depois de done
+    atomic_int done;
+    atomic_int refs;
+    Value args[];
+};
+
+void handle_retain(Handle *h) {
+    atomic_fetch_add_explicit(&h->refs, 1, memory_order_relaxed);
+}
+
+void handle_release(Handle *h) {
+    if (atomic_fetch_sub_explicit(&h->refs, 1, memory_order_acq_rel) == 1) free(h);
+}
+
+static void run_task(Task *task) {
+    Handle *h = (Handle*)task;
+    Interp *root = h->root;
+    Func *f = &root->funcs[h->index];
+    // So o frame da funcao: ela nao le globais (check_parallel). Sem
+    // quickening, JIT nem memo, como nos pedacos de parallel for.
+    Interp w = { 0 };
+    w.funcs = root->funcs;
+    w.func_count = root->func_count;
+    w.threads = root->threads;
+    w.pool = root->pool;
+    w.root = root;
+    w.stack_cap = f->locals + 16;
+    w.stack = malloc(sizeof(Value) * w.stack_cap);
+    for (int i = 0; i < f->param_count; i++) w.stack[w.stack_top++] = h->args[i];
+    push_slots(&w, f->locals - f->param_count);
+    w.call_depth = 1;
+    Value ret = value_none();
+    exec(&w, f->block, &ret);
+    pop_slots(&w, 0);
+    free(w.stack);
+    h->result = ret;
+    atomic_store_explicit(&h->done, 1, memory_order_release);
+    atomic_fetch_sub_explicit(&root->tasks, 1, memory_order_release);
+    handle_release(h);
+}
+
+// spawn f(args): com uma thread so, chama na hora e o handle e o proprio
+// resultado (como na VM); senao empilha a tarefa na deque desta thread.
+static Value spawn_task(Interp *in, AST *ast) {
+    int index = ast->list.index;
+    if (in->threads <= 1) return call_func(in, ast, index, in->memo && memo_active(index));
+    Interp *root = in->root;
+    Pool *pool = interp_pool(in);
+    // Daqui em diante outras threads leem os nos enquanto o programa segue:
+    // nada mais e especializado.
+    if (root->quicken) root->quicken = 0;
+    Func *f = &in->funcs[index];
+    Handle *h = malloc(sizeof(Handle) + sizeof(Value) * (f->param_count + 1));
+    for (int i = 0; i < f->param_count; i++) h->args[i] = eval_expr(in, ast->list.items[i]);
+    h->task.run = run_task;
+    h->root = root;
+    h->index = index;
+    h->result = value_none();
+    atomic_init(&h->done, 0);
+    atomic_init(&h->refs, 2);
+    atomic_fetch_add_explicit(&root->tasks, 1, memory_order_relaxed);
+    pool_push(pool, &h->task);
+    Value v = { VAL_TASK };
+    v.task = h;
+    return v;
+}
+
+// await h: enquanto a tarefa nao termina, esta thread executa outras (a
+// propria, se ninguem a roubou). Uma tarefa so espera as que ela mesma
+// criou (check_parallel), entao a que falta nunca esta suspensa mais abaixo
+// na pilha desta thread.
+static Value await_task(Interp *in, AST *ast) {
+    Value v = eval_expr(in, ast->stmt.expr);
+    if (v.type != VAL_TASK) return v;
+    Handle *h = v.task;
+    while (!atomic_load_explicit(&h->done, memory_order_acquire))
+        if (!pool_help(in->root->pool)) sched_yield();
+    Value result = h->result;
+    handle_release(h);
+    return result;
+}
+
+// Bloco com --profile: cada comando e medido (todo corpo e um bloco, entao
+// sem --profile o custo e um teste por bloco executado).
+static ExecStatus exec_profiled(Interp *in, AST *block, Value *ret) {
+    for (int i = 0; i < block->list.count; i++) {
+        profile_enter(block->list.items[i]);
+        ExecStatus status = exec(in, block->list.items[i], ret);
+        profile_exit();
+        if (status == EXEC_RETURN) return EXEC_RETURN;
+    }
+    return EXEC_NEXT;
+}
+
+static ExecStatus exec(Interp *in, AST *ast, Value *ret) {
+    if (!ast) return EXEC_NEXT;
     switch (ast->type) {
         case AST_PROGRAM:
-            for (int i = 0; i < ast->children_count; i++)
-                exec(ast->children[i]);
+            if (in->profile) return exec_profiled(in, ast, ret);
+            for (int i = 0; i < ast->list.count; i++)
+                if (exec(in, ast->list.items[i], ret) == EXEC_RETURN) return EXEC_RETURN;
             break;
         case AST_VAR_DECL: {
+            if (ast->op == DECL_ONLY) break;
             Value v = value_none();
-            if (ast->left) v = eval_expr(ast->left);
-            if (strcmp(ast->str_value, "int") == 0 && v.type != VAL_INT) v = value_int(0);
-            if (strcmp(ast->str_value, "string") == 0 && v.type != VAL_STRING) v = value_string("");
-            if (strcmp(ast->str_value, "bool") == 0 && v.type != VAL_BOOL) v = value_bool(0);
-            set_var(ast->name, v);
+            if (ast->stmt.expr) v = eval_expr(in, ast->stmt.expr);
+            v = value_coerce(v, ast->stmt.type_sym);
+            store_var(var_ref(in, ast, ast->stmt.slot), v);
             break;
         }
         case AST_ASSIGN: {
-            Value v = eval_expr(ast->left);
-            assign_var(ast->name, v);
-            break;
-        }
-        case AST_PRINT: {
-            Value v = eval_expr(ast->left);
-            if (v.type == VAL_INT) printf("%d\n", v.int_val);
-            else if (v.type == VAL_STRING) {
-                printf("%s\n", v.str_val);
-                free(v.str_val);
+            if (ast->op == ASSIGN_APPEND) {
+                // O primeiro item da concatenacao e a propria variavel.
+                AST *concat = ast->stmt.expr;
+                for (int i = 1; i < concat->list.count; i++)
+                    value_append(var_ref(in, ast, ast->stmt.slot), eval_expr(in, concat->list.items[i]));
+                break;
             }
-            else if (v.type == VAL_BOOL) printf("%s\n", v.bool_val ? "true" : "false");
+            Value v = eval_expr(in, ast->stmt.expr);
+            store_var(var_ref(in, ast, ast->stmt.slot), v);
             break;
         }
-        case AST_INPUT: {
-            Var* var = find_var(ast->name);
-            if (!var) { printf("Undefined variable: %s\n", ast->name); exit(1); }
-            if (var->value.type == VAL_INT) {
-                int tmp;
-                fflush(stdout);
-                scanf("%d", &tmp);
-                var->value.int_val = tmp;
-            } else if (var->value.type == VAL_STRING) {
-                char buf[256];
-                fflush(stdout);
-                if (fgets(buf, sizeof(buf), stdin)) {
-                    buf[strcspn(buf, "\n")] = 0;
-                    free(var->value.str_val);
-                    var->value.str_val = strdup(buf);
-                } else {
-                    if (var->value.str_val) free(var->value.str_val);
-                    var->value.str_val = strdup("");
-                }
-            } else if (var->value.type == VAL_BOOL) {
-                int tmp;
-                fflush(stdout);
-                scanf("%d", &tmp);
-                var->value.bool_val = (tmp != 0);
+        case AST_PRINT: {
+            AST *e = ast->stmt.expr;
+            if (e && e->type == AST_CONCAT) {
+                print_concat(in, e);
+                break;
             }
+            value_print(eval_expr(in, e));
             break;
         }
-        case AST_IF: {
-            Value cond = eval_expr(ast->cond);
-            if (is_truthy(cond)) {
-                exec(ast->then_body);
-            } else if (ast->else_body) {
-                exec(ast->else_body);
-            }
-            if (cond.type == VAL_STRING) free(cond.str_val);
+        case AST_INPUT:
+            value_input(var_ref(in, ast, ast->var.slot));
             break;
-        }
-        case AST_WHILE: {
-            while (1) {
-                Value cond = eval_expr(ast->cond);
-                int is_true = is_truthy(cond);
-                if (cond.type == VAL_STRING) free(cond.str_val);
-                if (!is_true) break;
-                exec(ast->body);
-            }
+        case AST_IF:
+            if (eval_cond(in, ast->branch.cond))
+                return exec(in, ast->branch.then_body, ret);
+            return exec(in, ast->branch.else_body, ret);
+        case AST_WHILE:
+            while (eval_cond(in, ast->loop.cond))
+                if (exec(in, ast->loop.body, ret) == EXEC_RETURN) return EXEC_RETURN;
             break;
-        }
-        case AST_FOR: {
-            push_scope();
-            exec(ast->init);
-            while (1) {
-                Value cond = eval_expr(ast->cond);
-                int is_true = is_truthy(cond);
-                if (cond.type == VAL_STRING) free(cond.str_val);
-                if (!is_true) break;
-                exec(ast->body);
-                exec(ast->incr);
+        case AST_FOR:
+            if (ast->op == FOR_COUNTED) return exec_counted(in, ast, ret);
+            exec(in, ast->loop.init, ret);
+            while (eval_cond(in, ast->loop.cond)) {
+                if (exec(in, ast->loop.body, ret) == EXEC_RETURN) return EXEC_RETURN;
+                exec(in, ast->loop.incr, ret);
             }
-            pop_scope();
-            break;
-        }
-        case AST_FUNC_DECL:
             break;
-        case AST_FUNC_CALL: {
-            eval_expr(ast);
+        case AST_PARALLEL_FOR:
+            return exec_parallel(in, ast, ret);
+        case AST_FUNC_CALL:
+        case AST_Q_CALL:
+            value_free(eval_expr(in, ast));
             break;
-        }
         case AST_RETURN: {
-            Value v = eval_expr(ast->left);
-            ret_val.is_returning = 1;
-            ret_val.value = v;
-            break;
+            Value v = eval_expr(in, ast->stmt.expr);
+            if (in->call_depth == 0) { // return fora de funcao e ignorado
+                value_free(v);
+                break;
+            }
+            *ret = v;
+            return EXEC_RETURN;
         }
         default: break;
     }
-}
\ No newline at end of file
+    return EXEC_NEXT;
+}
@@ -1,24 +1,34 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 #include "parser.h"
+#include "value.h"
+#include "resolve.h"
 
-typedef enum {
-    VAL_INT,
-    VAL_STRING,
-    VAL_BOOL,
-    VAL_NONE
-} ValueType;
+// Quickening: na primeira execucao, cada AST_BINOP, AST_IDENTIFIER e
+// AST_FUNC_CALL vira uma variante especializada (AST_Q_* em parser.h) pelos
+// tipos que viu; --no-quicken desliga.
+extern _Thread_local int quicken_enabled;
 
-typedef struct {
-    ValueType type;
-    union {
-        int int_val;
-        char *str_val;
-        int bool_val;
-    };
-} Value;
+// Threads de parallel for e spawn (0 ou 1: em sequencia). A CLI usa uma por
+// processador (--threads N); contextos embutidos e o lote rodam em sequencia.
+extern _Thread_local int parallel_threads;
 
-void init_vars(void);
-void interpret(AST *ast);
+// Estado de execucao de um programa ja resolvido (globais, pilha de frames).
+// Cada Interp e independente; um mesmo Interp nao deve ser usado por duas
+// threads ao mesmo tempo. interp_new copia quicken_enabled, jit_enabled e
+// parallel_threads da thread que o cria; memo e JIT, quando ligados, usam o
+// estado da thread.
+typedef struct Interp Interp;
+
+Interp *interp_new(AST *program, Frames frames);
+// Executa o codigo de topo (declaracoes globais, prints...).
+void interp_run(Interp *in, AST *program);
+// Chama a funcao `index` (ordem de declaracao) com argumentos ja do tipo
+// dos parametros, sem consumi-los; devolve o resultado.
+Value interp_call(Interp *in, int index, const Value *args);
+void interp_set_memo(Interp *in, int on);
+void interp_free(Interp *in);
+
+void interpret(AST *ast, Frames frames);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "io.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define IO_INPUT_BLOCK (64 * 1024)
+
+static _Thread_local char *out_buf;
+static _Thread_local size_t out_len, out_cap;
+static _Thread_local int out_fd = 1;
+static _Thread_local int registered;
+static _Thread_local int bound;     // saida de um MacsContext: sem atexit
+static _Thread_local int capture;   // acumula a saida em out_buf, sem descarregar
+
+static _Thread_local char *in_buf;  // IO_INPUT_BLOCK bytes, alocado na primeira leitura
+static _Thread_local size_t in_pos, in_len;
+static _Thread_local int in_eof;
+static _Thread_local char *line_buf;
+static _Thread_local size_t line_cap;
+
+static void write_all(const char *s, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(out_fd, s, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        s += n;
+        len -= (size_t)n;
+    }
+}
+
+void io_flush(void) {
+    if (capture) return;
+    write_all(out_buf, out_len);
+    out_len = 0;
+}
+
+static void io_free_buffers(void) {
+    free(out_buf);
+    free(line_buf);
+    free(in_buf);
+    out_buf = line_buf = in_buf = NULL;
+    out_cap = line_cap = 0;
+    in_pos = in_len = 0;
+}
+
+// Registrado com atexit: descarrega a saida mesmo em exit(1).
+static void io_shutdown(void) {
+    io_flush();
+    if (out_fd != 1) close(out_fd);
+    io_free_buffers();
+}
+
+static void io_register(void) {
+    if (!registered && !bound) {
+        atexit(io_shutdown);
+        registered = 1;
+    }
+}
+
+void io_init_output(int fd, size_t size) {
+    io_register();
+    io_flush();
+    if (size == 0) size = 1;
+    out_fd = fd;
+    out_buf = realloc(out_buf, size);
+    out_cap = size;
+}
+
+void io_bind(int fd) {
+    bound = 1;
+    capture = fd < 0;
+    out_fd = fd;
+    out_len = 0;
+    out_buf = realloc(out_buf, IO_DEFAULT_BUFFER);
+    out_cap = IO_DEFAULT_BUFFER;
+}
+
+char *io_release(size_t *len) {
+    char *text = NULL;
+    if (capture) {
+        text = out_buf;
+        *len = out_len;
+        out_buf = NULL;
+        out_len = 0;
+    } else {
+        io_flush();
+    }
+    io_free_buffers();
+    out_fd = 1;
+    bound = capture = 0;
+    return text;
+}
+
+void io_write(const char *s, size_t len) {
+    if (!out_cap) io_init_output(1, IO_DEFAULT_BUFFER);
+    if (out_len + len > out_cap) {
+        if (capture) {
+            while (out_len + len > out_cap) out_cap *= 2;
+            out_buf = realloc(out_buf, out_cap);
+            memcpy(out_buf + out_len, s, len);
+            out_len += len;
+            return;
+        }
+        io_flush();
+        // Maior que o buffer: vai direto, sem copiar.
+        if (len >= out_cap) {
+            write_all(s, len);
+            return;
+        }
+    }
+    memcpy(out_buf + out_len, s, len);
+    out_len += len;
+}
+
+// Proximo byte de stdin sem consumi-lo, ou -1 no fim.
+static int in_peek(void) {
+    if (in_pos == in_len) {
+        if (in_eof) return -1;
+        ssize_t n;
+        if (!in_buf) in_buf = malloc(IO_INPUT_BLOCK);
+        do n = read(0, in_buf, IO_INPUT_BLOCK); while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            in_eof = 1;
+            return -1;
+        }
+        in_pos = 0;
+        in_len = (size_t)n;
+    }
+    return (unsigned char)in_buf[in_pos];
+}
+
+int io_read_int(int *out) {
+    int c;
+    while ((c = in_peek()) == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f')
+        in_pos++;
+    int neg = 0;
+    if (c == '-' || c == '+') {
+        neg = c == '-';
+        in_pos++;
+        c = in_peek();
+    }
+    if (c < '0' || c > '9') {
+        *out = 0;
+        return 0;
+    }
+    unsigned int value = 0;
+    while ((c = in_peek()) >= '0' && c <= '9') {
+        value = value * 10 + (unsigned int)(c - '0');
+        in_pos++;
+    }
+    *out = neg ? (int)(0u - value) : (int)value;
+    return 1;
+}
+
+const char *io_read_line(int *len) {
+    size_t n = 0;
+    int c;
+    while ((c = in_peek()) != -1) {
+        // Copia o trecho ate o '\n' (ou o fim do bloco) de uma vez.
+        char *nl = memchr(in_buf + in_pos, '\n', in_len - in_pos);
+        size_t chunk = nl ? (size_t)(nl - (in_buf + in_pos)) : in_len - in_pos;
+        if (n + chunk + 1 > line_cap) {
+            io_register();
+            line_cap = (n + chunk + 1) * 2;
+            line_buf = realloc(line_buf, line_cap);
+        }
+        memcpy(line_buf + n, in_buf + in_pos, chunk);
+        n += chunk;
+        in_pos += chunk;
+        if (nl) {
+            in_pos++;
+            break;
+        }
+    }
+    if (!line_buf) {
+        io_register();
+        line_cap = 16;
+        line_buf = malloc(line_cap);
+    }
+    line_buf[n] = '\0';
+    *len = (int)n;
+    return line_buf;
+}
@@ -0,0 +1,28 @@
+#ifndef IO_H
+#define IO_H
+#include <stddef.h>
+
+// E/S do programa em execucao. A saida vai para um buffer proprio que so e
+// descarregado (com write(2)) quando enche, antes de cada input e na saida do
+// processo. A entrada e lida de stdin em blocos e tokenizada aqui mesmo.
+#define IO_DEFAULT_BUFFER (64 * 1024)
+
+// Direciona a saida para `fd` com um buffer de `size` bytes. Sem chamada, a
+// saida vai para stdout com IO_DEFAULT_BUFFER.
+void io_init_output(int fd, size_t size);
+// Saida de um MacsContext (macslang.h): escreve em `fd` sem registrar
+// atexit; io_release descarrega e solta os buffers da thread. Com fd < 0 a
+// saida e acumulada em memoria e io_release a devolve (malloc, *len bytes);
+// senao devolve NULL.
+void io_bind(int fd);
+char *io_release(size_t *len);
+void io_write(const char *s, size_t len);
+void io_flush(void);
+
+// Le o proximo inteiro (espacos antes sao ignorados, como em scanf("%d"));
+// devolve 0 se nao houver numero.
+int io_read_int(int *out);
+// Le o resto da linha atual, sem o '\n'. O ponteiro vale ate a proxima chamada.
+const char *io_read_line(int *len);
+
+#endif
@@ -0,0 +1,466 @@
+#include "jit.h"
+#include "symtab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_X86_64 1
+#include <sys/mman.h>
+#endif
+
+_Thread_local int jit_enabled;
+
+typedef struct {
+    AST *decl;
+    int eligible;       // so usa int/bool, sempre retorna e so chama elegiveis
+    int calls;
+    JitEntry entry;     // lido pelo codigo gerado em chamadas entre funcoes
+    int offset;         // posicao no buffer durante a compilacao
+} JitFunc;
+
+typedef struct Mapping {
+    void *mem;
+    size_t len;
+    struct Mapping *next;
+} Mapping;
+
+static _Thread_local JitFunc *jfuncs;
+static _Thread_local int jfunc_count;
+static _Thread_local int threshold;
+static _Thread_local Mapping *mappings;
+
+static int is_scalar(int type_sym) {
+    return type_sym == SYM_INT || type_sym == SYM_BOOL;
+}
+
+// ---- Elegibilidade ----
+
+static int expr_ok(AST *ast) {
+    switch (ast->type) {
+        case AST_LITERAL:
+            return ast->vtype == TYPE_INT || ast->vtype == TYPE_BOOL;
+        case AST_IDENTIFIER:
+            return ast->depth == SLOT_LOCAL && (ast->vtype == TYPE_INT || ast->vtype == TYPE_BOOL);
+        case AST_BINOP:
+            return expr_ok(ast->bin.left) && expr_ok(ast->bin.right);
+        case AST_FUNC_CALL:
+            for (int i = 0; i < ast->list.count; i++)
+                if (!expr_ok(ast->list.items[i])) return 0;
+            return is_scalar(jfuncs[ast->list.index].decl->func.type_sym);
+        default:
+            return 0;
+    }
+}
+
+static int stmt_ok(AST *ast) {
+    if (!ast) return 1;
+    switch (ast->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                if (!stmt_ok(ast->list.items[i])) return 0;
+            return 1;
+        case AST_VAR_DECL:
+            return ast->depth == SLOT_LOCAL && is_scalar(ast->stmt.type_sym) &&
+                   (!ast->stmt.expr || expr_ok(ast->stmt.expr));
+        case AST_ASSIGN:
+            return ast->depth == SLOT_LOCAL && ast->op != ASSIGN_APPEND && expr_ok(ast->stmt.expr);
+        case AST_RETURN:
+            return ast->stmt.expr && expr_ok(ast->stmt.expr);
+        case AST_FUNC_CALL:
+            return expr_ok(ast);
+        case AST_IF:
+            return expr_ok(ast->branch.cond) && stmt_ok(ast->branch.then_body) && stmt_ok(ast->branch.else_body);
+        case AST_WHILE:
+            return expr_ok(ast->loop.cond) && stmt_ok(ast->loop.body);
+        case AST_FOR:
+            return stmt_ok(ast->loop.init) && expr_ok(ast->loop.cond) &&
+                   stmt_ok(ast->loop.incr) && stmt_ok(ast->loop.body);
+        default:
+            return 0;
+    }
+}
+
+// Todo caminho termina em return? (senao a funcao devolveria "none", que o
+// codigo nativo nao representa)
+static int always_returns(AST *ast) {
+    if (!ast) return 0;
+    switch (ast->type) {
+        case AST_RETURN:
+            return 1;
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                if (always_returns(ast->list.items[i])) return 1;
+            return 0;
+        case AST_IF:
+            return always_returns(ast->branch.then_body) && always_returns(ast->branch.else_body);
+        default:
+            return 0;
+    }
+}
+
+static int calls_ineligible(AST *ast) {
+    if (!ast) return 0;
+    switch (ast->type) {
+        case AST_FUNC_CALL:
+            if (!jfuncs[ast->list.index].eligible) return 1;
+            for (int i = 0; i < ast->list.count; i++)
+                if (calls_ineligible(ast->list.items[i])) return 1;
+            return 0;
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                if (calls_ineligible(ast->list.items[i])) return 1;
+            return 0;
+        case AST_BINOP:
+            return calls_ineligible(ast->bin.left) || calls_ineligible(ast->bin.right);
+        case AST_VAR_DECL: case AST_ASSIGN: case AST_RETURN:
+            return calls_ineligible(ast->stmt.expr);
+        case AST_IF:
+            return calls_ineligible(ast->branch.cond) || calls_ineligible(ast->branch.then_body) ||
+                   calls_ineligible(ast->branch.else_body);
+        case AST_WHILE: case AST_FOR:
+            return calls_ineligible(ast->loop.init) || calls_ineligible(ast->loop.cond) ||
+                   calls_ineligible(ast->loop.incr) || calls_ineligible(ast->loop.body);
+        default:
+            return 0;
+    }
+}
+
+static void find_eligible(void) {
+    for (int i = 0; i < jfunc_count; i++) {
+        AST *decl = jfuncs[i].decl;
+        int ok = is_scalar(decl->func.type_sym) && always_returns(decl->func.body);
+        for (int p = 0; ok && p < decl->func.params_count; p++)
+            ok = is_scalar(decl->func.params[p].type);
+        jfuncs[i].eligible = ok && stmt_ok(decl->func.body);
+    }
+    // Quem chama uma funcao nao elegivel tambem deixa de ser, ate estabilizar
+    // (cobre recursao mutua).
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < jfunc_count; i++) {
+            if (jfuncs[i].eligible && calls_ineligible(jfuncs[i].decl->func.body)) {
+                jfuncs[i].eligible = 0;
+                changed = 1;
+            }
+        }
+    }
+}
+
+#ifdef JIT_X86_64
+
+// ---- Emissao de codigo x86-64 ----
+//
+// Expressoes sao avaliadas em eax; temporarios vao para a pilha de maquina
+// (push/pop). Parametros e locais ficam em slots de 8 bytes abaixo de rbp.
+
+static _Thread_local unsigned char *code;
+static _Thread_local size_t code_len, code_cap;
+static _Thread_local int push_depth;      // pushes pendentes, para alinhar rsp nas chamadas
+
+static void emit_bytes(const void *bytes, size_t n) {
+    if (code_len + n > code_cap) {
+        code_cap = code_cap ? code_cap * 2 : 4096;
+        while (code_len + n > code_cap) code_cap *= 2;
+        code = realloc(code, code_cap);
+    }
+    memcpy(code + code_len, bytes, n);
+    code_len += n;
+}
+
+#define EMIT(...) do { unsigned char b_[] = { __VA_ARGS__ }; emit_bytes(b_, sizeof(b_)); } while (0)
+
+static void emit32(int v) {
+    emit_bytes(&v, 4);
+}
+
+static int slot_disp(int slot) {
+    return -8 * (slot + 1);
+}
+
+// Salto com deslocamento de 32 bits a corrigir; devolve a posicao dele.
+static size_t emit_jump(unsigned char op) {
+    if (op == 0xE9) EMIT(0xE9);
+    else EMIT(0x0F, op);
+    emit32(0);
+    return code_len - 4;
+}
+
+static void patch_to(size_t at, size_t target) {
+    int rel = (int)(target - (at + 4));
+    memcpy(code + at, &rel, 4);
+}
+
+static void jump_back(size_t target) {
+    EMIT(0xE9);
+    emit32((int)(target - (code_len + 4)));
+}
+
+static void gen_expr(AST *ast);
+
+static void gen_call(AST *ast) {
+    int n = ast->list.count;
+    for (int i = 0; i < n; i++) {
+        gen_expr(ast->list.items[i]);
+        EMIT(0x50);                         // push rax
+        push_depth++;
+    }
+    EMIT(0x48, 0x89, 0xE7);                 // mov rdi, rsp
+    int pad = push_depth % 2;
+    if (pad) EMIT(0x48, 0x83, 0xEC, 0x08);  // sub rsp, 8
+    JitEntry *cell = &jfuncs[ast->list.index].entry;
+    EMIT(0x48, 0xB8);                       // mov rax, &cell
+    emit_bytes(&cell, 8);
+    EMIT(0xFF, 0x10);                       // call [rax]
+    int drop = 8 * (n + pad);
+    if (drop) {
+        EMIT(0x48, 0x81, 0xC4);             // add rsp, drop
+        emit32(drop);
+    }
+    push_depth -= n;
+}
+
+static void gen_binop(AST *ast) {
+    gen_expr(ast->bin.left);
+    EMIT(0x50);                             // push rax
+    push_depth++;
+    gen_expr(ast->bin.right);
+    EMIT(0x89, 0xC1);                       // mov ecx, eax
+    EMIT(0x58);                             // pop rax
+    push_depth--;
+    unsigned char setcc = 0;
+    switch (ast->op) {
+        case OP_ADD: EMIT(0x01, 0xC8); return;          // add eax, ecx
+        case OP_SUB: EMIT(0x29, 0xC8); return;          // sub eax, ecx
+        case OP_MUL: EMIT(0x0F, 0xAF, 0xC1); return;    // imul eax, ecx
+        case OP_DIV:
+        case OP_MOD: {
+            // Mesma semantica de int_div/int_mod: divisor 0 da 0 e -1 nao trapa.
+            EMIT(0x85, 0xC9);                           // test ecx, ecx
+            EMIT(0x75, 0x04);                           // jnz +4
+            EMIT(0x31, 0xC0);                           // xor eax, eax
+            EMIT(0xEB, 0x00);                           // jmp fim (corrigido abaixo)
+            size_t skip_zero = code_len - 1;
+            EMIT(0x83, 0xF9, 0xFF);                     // cmp ecx, -1
+            EMIT(0x75, 0x04);                           // jne +4
+            if (ast->op == OP_DIV) EMIT(0xF7, 0xD8);    // neg eax
+            else EMIT(0x31, 0xC0);                      // xor eax, eax
+            EMIT(0xEB, 0x00);
+            size_t skip_neg = code_len - 1;
+            EMIT(0x99, 0xF7, 0xF9);                     // cdq; idiv ecx
+            if (ast->op == OP_MOD) EMIT(0x89, 0xD0);    // mov eax, edx
+            code[skip_zero] = (unsigned char)(code_len - (skip_zero + 1));
+            code[skip_neg] = (unsigned char)(code_len - (skip_neg + 1));
+            return;
+        }
+        case OP_EQ: setcc = 0x94; break;
+        case OP_NEQ: setcc = 0x95; break;
+        case OP_LT: setcc = 0x9C; break;
+        case OP_LTE: setcc = 0x9E; break;
+        case OP_GT: setcc = 0x9F; break;
+        case OP_GTE: setcc = 0x9D; break;
+    }
+    EMIT(0x39, 0xC8);                       // cmp eax, ecx
+    EMIT(0x0F, setcc, 0xC0);                // setcc al
+    EMIT(0x0F, 0xB6, 0xC0);                 // movzx eax, al
+}
+
+static void gen_expr(AST *ast) {
+    // O interpretador pode ja ter especializado nos desta funcao.
+    switch (ast_kind(ast)) {
+        case AST_LITERAL:
+            EMIT(0xB8);                     // mov eax, imm32
+            emit32(ast->lit.int_value);
+            break;
+        case AST_IDENTIFIER:
+            EMIT(0x8B, 0x85);               // mov eax, [rbp + disp]
+            emit32(slot_disp(ast->var.slot));
+            break;
+        case AST_BINOP:
+            gen_binop(ast);
+            break;
+        case AST_FUNC_CALL:
+            gen_call(ast);
+            break;
+        default:
+            break;
+    }
+}
+
+static void store_slot(int slot) {
+    EMIT(0x89, 0x85);                       // mov [rbp + disp], eax
+    emit32(slot_disp(slot));
+}
+
+// Condicao em eax: salta se falsa; devolve a posicao do salto a corrigir.
+static size_t gen_cond_jump(AST *cond) {
+    gen_expr(cond);
+    EMIT(0x85, 0xC0);                       // test eax, eax
+    return emit_jump(0x84);                 // jz
+}
+
+static void gen_stmt(AST *ast) {
+    if (!ast) return;
+    switch (ast_kind(ast)) {
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                gen_stmt(ast->list.items[i]);
+            break;
+        case AST_VAR_DECL:
+            if (ast->op == DECL_ONLY) break;
+            if (ast->stmt.expr) gen_expr(ast->stmt.expr);
+            else EMIT(0x31, 0xC0);          // xor eax, eax
+            store_slot(ast->stmt.slot);
+            break;
+        case AST_ASSIGN:
+            gen_expr(ast->stmt.expr);
+            store_slot(ast->stmt.slot);
+            break;
+        case AST_RETURN:
+            gen_expr(ast->stmt.expr);
+            EMIT(0x48, 0x89, 0xEC, 0x5D, 0xC3);  // mov rsp, rbp; pop rbp; ret
+            break;
+        case AST_FUNC_CALL:
+            gen_call(ast);
+            break;
+        case AST_IF: {
+            size_t to_else = gen_cond_jump(ast->branch.cond);
+            gen_stmt(ast->branch.then_body);
+            if (ast->branch.else_body) {
+                size_t to_end = emit_jump(0xE9);
+                patch_to(to_else, code_len);
+                gen_stmt(ast->branch.else_body);
+                patch_to(to_end, code_len);
+            } else {
+                patch_to(to_else, code_len);
+            }
+            break;
+        }
+        case AST_WHILE: {
+            size_t top = code_len;
+            size_t to_end = gen_cond_jump(ast->loop.cond);
+            gen_stmt(ast->loop.body);
+            jump_back(top);
+            patch_to(to_end, code_len);
+            break;
+        }
+        case AST_FOR: {
+            gen_stmt(ast->loop.init);
+            size_t top = code_len;
+            size_t to_end = gen_cond_jump(ast->loop.cond);
+            gen_stmt(ast->loop.body);
+            gen_stmt(ast->loop.incr);
+            jump_back(top);
+            patch_to(to_end, code_len);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void gen_function(JitFunc *f) {
+    AST *decl = f->decl;
+    int n = decl->func.params_count;
+    f->offset = (int)code_len;
+    push_depth = 0;
+    EMIT(0x55, 0x48, 0x89, 0xE5);           // push rbp; mov rbp, rsp
+    int frame = (8 * decl->func.locals + 15) & ~15;
+    if (frame) {
+        EMIT(0x48, 0x81, 0xEC);             // sub rsp, frame
+        emit32(frame);
+    }
+    for (int i = 0; i < n; i++) {
+        EMIT(0x8B, 0x87);                   // mov eax, [rdi + 8*(n-1-i)]
+        emit32(8 * (n - 1 - i));
+        store_slot(i);
+    }
+    gen_stmt(decl->func.body);
+}
+
+// Compila de uma vez todas as funcoes elegiveis ainda sem codigo: como so
+// chamam umas as outras, qualquer chamada feita pelo codigo nativo ja tem
+// destino.
+static void compile_pending(void) {
+    code_len = 0;
+    int any = 0;
+    for (int i = 0; i < jfunc_count; i++) {
+        if (jfuncs[i].eligible && !jfuncs[i].entry) {
+            gen_function(&jfuncs[i]);
+            any = 1;
+        }
+    }
+    if (!any) return;
+
+    void *mem = mmap(NULL, code_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED || (memcpy(mem, code, code_len), mprotect(mem, code_len, PROT_READ | PROT_EXEC)) != 0) {
+        // Sem memoria executavel: tudo fica no interpretador.
+        if (mem != MAP_FAILED) munmap(mem, code_len);
+        for (int i = 0; i < jfunc_count; i++) jfuncs[i].eligible = 0;
+        return;
+    }
+    Mapping *m = malloc(sizeof(Mapping));
+    m->mem = mem;
+    m->len = code_len;
+    m->next = mappings;
+    mappings = m;
+    for (int i = 0; i < jfunc_count; i++)
+        if (jfuncs[i].eligible && !jfuncs[i].entry)
+            jfuncs[i].entry = (JitEntry)(void*)((unsigned char*)mem + jfuncs[i].offset);
+}
+
+#else
+
+static void compile_pending(void) {
+    for (int i = 0; i < jfunc_count; i++) jfuncs[i].eligible = 0;
+}
+
+#endif
+
+void jit_init(AST *program, int calls_threshold) {
+    threshold = calls_threshold < 1 ? 1 : calls_threshold;
+    jfuncs = calloc(program->list.count + 1, sizeof(JitFunc));
+    jfunc_count = 0;
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type == AST_FUNC_DECL) jfuncs[jfunc_count++].decl = stmt;
+    }
+    find_eligible();
+}
+
+JitEntry jit_hot(int index) {
+    JitFunc *f = &jfuncs[index];
+    if (f->entry || !f->eligible) return f->entry;
+    if (++f->calls >= threshold) compile_pending();
+    return f->entry;
+}
+
+Value jit_call(JitEntry entry, int index, const Value *args, int n) {
+    long long inline_slots[16] = { 0 };
+    long long *slots = n <= 16 ? inline_slots : malloc(sizeof(long long) * n);
+    for (int i = 0; i < n; i++) slots[n - 1 - i] = args[i].int_val;
+    int result = entry(slots);
+    if (slots != inline_slots) free(slots);
+    if (jfuncs[index].decl->func.type_sym == SYM_BOOL) return value_bool(result);
+    return value_int(result);
+}
+
+void jit_free(void) {
+    while (mappings) {
+        Mapping *next = mappings->next;
+#ifdef JIT_X86_64
+        munmap(mappings->mem, mappings->len);
+#endif
+        free(mappings);
+        mappings = next;
+    }
+#ifdef JIT_X86_64
+    free(code);
+    code = NULL;
+    code_len = code_cap = 0;
+#endif
+    free(jfuncs);
+    jfuncs = NULL;
+    jfunc_count = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef JIT_H
+#define JIT_H
+#include "parser.h"
+#include "value.h"
+
+// JIT de base para x86-64 (--jit). Funcoes que so usam int e bool (parametros,
+// locais, retorno e chamadas a outras funcoes assim) sao compiladas para
+// codigo nativo quando atingem o limite de chamadas; o resto continua no
+// interpretador. Fora de x86-64 nada e compilado.
+//
+// Convencao do codigo gerado: um ponteiro para os argumentos, cada um num
+// slot de 8 bytes e em ordem inversa (o ultimo argumento em args[0]), como
+// ficam depois de empilhados; o resultado volta em eax.
+typedef int (*JitEntry)(const long long *args);
+
+#define JIT_DEFAULT_THRESHOLD 100
+
+// Prepara a tabela de funcoes, na ordem de list.index.
+void jit_init(AST *program, int threshold);
+// Conta uma chamada da funcao `index`; devolve o codigo nativo, se houver.
+JitEntry jit_hot(int index);
+// Executa o codigo nativo da funcao `index` com os argumentos em ordem.
+Value jit_call(JitEntry entry, int index, const Value *args, int n);
+void jit_free(void);
+
+extern _Thread_local int jit_enabled;
+
+#endif
@@ -1,129 +1,243 @@
 #include "lexer.h"
+#include "errors.h"
+#include "symtab.h"
+#include "scan.h"
+#include "source.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
 
-static const char *src;
-static int pos;
+// `src` e a janela atual do codigo fonte; `pos`, `len` e `tok_start` sao
+// relativos a ela e `base` e o offset absoluto de src[0]. Com um fonte mapeado
+// a janela e o arquivo inteiro; em streaming, os bytes anteriores ao token em
+// construcao sao descartados a cada novo bloco lido.
+static _Thread_local const char *src;
+static _Thread_local int pos;
+static _Thread_local int len;
+static _Thread_local int base;
+static _Thread_local int tok_start;
+static _Thread_local Source *stream;
+// Quebras de linha contadas ate src[line_pos] (relativo a janela); a linha
+// atual comeca no offset absoluto line_start.
+static _Thread_local int line, line_pos, line_start;
+
+static void count_lines(int upto) {
+    const char *p = src + line_pos, *end = src + upto, *nl;
+    while (p < end && (nl = memchr(p, '\n', (size_t)(end - p)))) {
+        line++;
+        p = nl + 1;
+        line_start = base + (int)(p - src);
+    }
+    line_pos = upto;
+}
 
-static Token make_token(TokenType t, const char *text) {
-    Token tok = { t };
-    if (text) strncpy(tok.text, text, 255);
+static Token make_token(TokenType t, int start, int length) {
+    count_lines(start);
+    Token tok = { t, base + start, length, 0, -1, NULL, line, base + start - line_start + 1 };
     return tok;
 }
 
 void init_lexer(const char *s) {
+    scan_init();
     src = s;
-    pos = 0;
+    pos = base = tok_start = 0;
+    len = (int)strlen(s);
+    stream = NULL;
+    line = 1;
+    line_pos = line_start = 0;
+}
+
+void init_lexer_source(Source *s) {
+    scan_init();
+    stream = s;
+    src = s->data;
+    pos = base = tok_start = 0;
+    len = (int)s->len;
+    line = 1;
+    line_pos = line_start = 0;
+}
+
+// Pede mais um bloco ao fonte em streaming. Tudo antes de `tok_start` e
+// descartado, entao posicoes locais guardadas antes da chamada ficam invalidas.
+static int more(void) {
+    if (!stream || stream->eof) return 0;
+    int shift = tok_start;
+    count_lines(shift);
+    line_pos -= shift;
+    size_t added = source_refill(stream, shift);
+    base += shift;
+    pos -= shift;
+    tok_start = 0;
+    src = stream->data;
+    len = (int)stream->len;
+    return added > 0;
+}
+
+static char peek(int k) {
+    while (pos + k >= len && more());
+    return pos + k < len ? src[pos + k] : '\0';
+}
+
+// Texto bruto do token (sem '\0' final, use `length`). So e valido para o
+// token mais recente: em streaming a janela anda a cada get_next_token.
+const char *token_text(const Token *tok) {
+    return src + (tok->start - base);
 }
 
 static void skip_ws() {
     while (1) {
-        while (isspace(src[pos])) pos++;
-        if (src[pos] == '/' && src[pos+1] == '/') {
-            pos += 2;
-            while (src[pos] && src[pos] != '\n') pos++;
+        tok_start = pos;
+        pos = (int)scanner.skip_space(src, pos, len);
+        if (pos == len && more()) continue;
+        if (src[pos] == '/' && peek(1) == '/') {
+            pos = (int)scanner.find_newline(src, pos + 2, len);
+            while (pos == len && (tok_start = pos, more()))
+                pos = (int)scanner.find_newline(src, pos, len);
         } else {
             break;
         }
     }
+    tok_start = pos;
 }
 
 static int is_id_start(char c) {
-    return isalpha(c) || c == '_';
-}
-
-static int is_id_char(char c) {
-    return isalnum(c) || c == '_';
+    return isalpha((unsigned char)c) || c == '_';
 }
 
+// Como em io_read_int e na aritmetica, literais acima de INT_MAX dao a volta
+// modulo 2^32 (em unsigned, sem estouro indefinido).
 static Token read_number() {
-    int start = pos;
-    while (isdigit(src[pos])) pos++;
-    Token t = make_token(TOK_INT, NULL);
-    t.int_value = atoi(&src[start]);
+    unsigned int value = 0;
+    while (isdigit((unsigned char)peek(0)))
+        value = value * 10 + (unsigned int)(src[pos++] - '0');
+    Token t = make_token(TOK_INT, tok_start, pos - tok_start);
+    t.int_value = (int)value;
     return t;
 }
 
+// Reconhecimento de palavras-chave sem strcmp em cascata: o tamanho e o
+// primeiro caractere ja identificam o unico candidato possivel.
+static TokenType keyword_type(const char *s, int len) {
+#define KW(word, tok) return memcmp(s, word, len) == 0 ? tok : TOK_IDENTIFIER
+    switch (len) {
+        case 2: if (s[0] == 'i') KW("if", TOK_IF); break;
+        case 3:
+            if (s[0] == 'v') KW("var", TOK_VAR);
+            if (s[0] == 'f') KW("for", TOK_FOR);
+            break;
+        case 4:
+            if (s[0] == 'f') KW("func", TOK_FUNC);
+            if (s[0] == 'e') KW("else", TOK_ELSE);
+            if (s[0] == 't') KW("true", TOK_TRUE);
+            break;
+        case 5:
+            switch (s[0]) {
+                case 'w': KW("while", TOK_WHILE);
+                case 'p': KW("print", TOK_PRINT);
+                case 'i': KW("input", TOK_INPUT);
+                case 'f': KW("false", TOK_FALSE);
+                case 's': KW("spawn", TOK_SPAWN);
+                case 'a': KW("await", TOK_AWAIT);
+            }
+            break;
+        case 6:
+            if (s[0] == 'r' && s[2] == 't') KW("return", TOK_RETURN);
+            if (s[0] == 'r') KW("reduce", TOK_REDUCE);
+            break;
+        case 8: if (s[0] == 'p') KW("parallel", TOK_PARALLEL); break;
+    }
+#undef KW
+    return TOK_IDENTIFIER;
+}
+
 static Token read_identifier() {
-    int start = pos;
-    while (is_id_char(src[pos])) pos++;
-    int len = pos - start;
-    char buf[64] = {0};
-    strncpy(buf, &src[start], len);
-
-    if (strcmp(buf, "var") == 0)      return make_token(TOK_VAR, buf);
-    if (strcmp(buf, "func") == 0)     return make_token(TOK_FUNC, buf);
-    if (strcmp(buf, "if") == 0)       return make_token(TOK_IF, buf);
-    if (strcmp(buf, "else") == 0)     return make_token(TOK_ELSE, buf);
-    if (strcmp(buf, "while") == 0)    return make_token(TOK_WHILE, buf);
-    if (strcmp(buf, "for") == 0)      return make_token(TOK_FOR, buf);
-    if (strcmp(buf, "print") == 0)    return make_token(TOK_PRINT, buf);
-    if (strcmp(buf, "input") == 0)    return make_token(TOK_INPUT, buf);
-    if (strcmp(buf, "return") == 0)   return make_token(TOK_RETURN, buf);
-    if (strcmp(buf, "true") == 0)     return make_token(TOK_TRUE, buf);
-    if (strcmp(buf, "false") == 0)    return make_token(TOK_FALSE, buf);
-
-    Token t = make_token(TOK_IDENTIFIER, buf);
+    pos = (int)scanner.skip_ident(src, pos, len);
+    while (pos == len && more())
+        pos = (int)scanner.skip_ident(src, pos, len);
+    int n = pos - tok_start;
+
+    Token t = make_token(keyword_type(&src[tok_start], n), tok_start, n);
+    if (t.type == TOK_IDENTIFIER)
+        t.sym = sym_intern(&src[tok_start], n);
     return t;
 }
 
 static Token read_string() {
-    pos++; 
-    char buf[256] = {0};
-    int i = 0;
-    while (src[pos] && src[pos] != '"' && i < 255) {
-        if (src[pos] == '\\' && src[pos+1] == 'n') {
-            buf[i++] = '\n';
+    pos++;
+    int escapes = 0;
+    while (1) {
+        pos = (int)scanner.find_quote(src, pos, len);
+        if (pos >= len) {
+            if (more()) continue;
+            break;
+        }
+        if (src[pos] == '"') break;
+        if (peek(1) == 'n') {
+            escapes = 1;
             pos += 2;
         } else {
-            buf[i++] = src[pos++];
+            pos++;
         }
     }
+    int start = tok_start + 1;
+    Token t = make_token(TOK_STRING, start, pos - start);
     if (src[pos] == '"') pos++;
-    Token t = make_token(TOK_STRING, buf);
+    if (escapes) {
+        char *buf = malloc(t.length + 1);
+        int i = 0;
+        for (int p = start; p < start + t.length; p++) {
+            if (src[p] == '\\' && src[p+1] == 'n') {
+                buf[i++] = '\n';
+                p++;
+            } else {
+                buf[i++] = src[p];
+            }
+        }
+        buf[i] = '\0';
+        t.str = buf;
+    }
     return t;
 }
 
 Token get_next_token(void) {
     skip_ws();
     char c = src[pos];
-    if (!c) return make_token(TOK_EOF, NULL);
+    if (pos >= len || !c) return make_token(TOK_EOF, tok_start, 0);
 
-    if (isdigit(c)) return read_number();
+    if (isdigit((unsigned char)c)) return read_number();
 
     if (is_id_start(c)) return read_identifier();
 
     if (c == '"') return read_string();
 
-    if (c == '(') { pos++; return make_token(TOK_LPAREN, "("); }
-    if (c == ')') { pos++; return make_token(TOK_RPAREN, ")"); }
-    if (c == '{') { pos++; return make_token(TOK_LBRACE, "{"); }
-    if (c == '}') { pos++; return make_token(TOK_RBRACE, "}"); }
-    if (c == ':') { pos++; return make_token(TOK_COLON, ":"); }
-    if (c == ',') { pos++; return make_token(TOK_COMMA, ","); }
-    if (c == ';') { pos++; return make_token(TOK_SEMI, ";"); }
-    if (c == '+') { pos++; return make_token(TOK_PLUS, "+"); }
-    if (c == '-') { pos++; return make_token(TOK_MINUS, "-"); }
-    if (c == '*') { pos++; return make_token(TOK_STAR, "*"); }
-    if (c == '/') { pos++; return make_token(TOK_SLASH, "/"); }
-    if (c == '%') { pos++; return make_token(TOK_PERCENT, "%"); }
+    if (c == '(') { pos++; return make_token(TOK_LPAREN, tok_start, 1); }
+    if (c == ')') { pos++; return make_token(TOK_RPAREN, tok_start, 1); }
+    if (c == '{') { pos++; return make_token(TOK_LBRACE, tok_start, 1); }
+    if (c == '}') { pos++; return make_token(TOK_RBRACE, tok_start, 1); }
+    if (c == ':') { pos++; return make_token(TOK_COLON, tok_start, 1); }
+    if (c == ',') { pos++; return make_token(TOK_COMMA, tok_start, 1); }
+    if (c == ';') { pos++; return make_token(TOK_SEMI, tok_start, 1); }
+    if (c == '+') { pos++; return make_token(TOK_PLUS, tok_start, 1); }
+    if (c == '-') { pos++; return make_token(TOK_MINUS, tok_start, 1); }
+    if (c == '*') { pos++; return make_token(TOK_STAR, tok_start, 1); }
+    if (c == '/') { pos++; return make_token(TOK_SLASH, tok_start, 1); }
+    if (c == '%') { pos++; return make_token(TOK_PERCENT, tok_start, 1); }
     if (c == '=') {
-        if (src[pos+1] == '=') { pos+=2; return make_token(TOK_EQ, "=="); }
-        pos++; return make_token(TOK_ASSIGN, "=");
+        if (peek(1) == '=') { pos+=2; return make_token(TOK_EQ, tok_start, 2); }
+        pos++; return make_token(TOK_ASSIGN, tok_start, 1);
     }
     if (c == '!') {
-        if (src[pos+1] == '=') { pos+=2; return make_token(TOK_NEQ, "!="); }
+        if (peek(1) == '=') { pos+=2; return make_token(TOK_NEQ, tok_start, 2); }
     }
     if (c == '<') {
-        if (src[pos+1] == '=') { pos+=2; return make_token(TOK_LTE, "<="); }
-        pos++; return make_token(TOK_LT, "<");
+        if (peek(1) == '=') { pos+=2; return make_token(TOK_LTE, tok_start, 2); }
+        pos++; return make_token(TOK_LT, tok_start, 1);
     }
     if (c == '>') {
-        if (src[pos+1] == '=') { pos+=2; return make_token(TOK_GTE, ">="); }
-        pos++; return make_token(TOK_GT, ">");
+        if (peek(1) == '=') { pos+=2; return make_token(TOK_GTE, tok_start, 2); }
+        pos++; return make_token(TOK_GT, tok_start, 1);
     }
-    printf("Unknown character: %c\n", c);
-    exit(1);
-}
\ No newline at end of file
+    error_printf("Unknown character: %c\n", c);
+    error_exit();
+}
@@ -1,5 +1,6 @@
 #ifndef LEXER_H
 #define LEXER_H
+#include "source.h"
 
 typedef enum {
     TOK_EOF,
@@ -8,6 +9,7 @@ typedef enum {
     TOK_STRING,
     TOK_TRUE, TOK_FALSE,
     TOK_VAR, TOK_FUNC, TOK_IF, TOK_ELSE, TOK_WHILE, TOK_FOR, TOK_PRINT, TOK_INPUT, TOK_RETURN,
+    TOK_PARALLEL, TOK_REDUCE, TOK_SPAWN, TOK_AWAIT,
     TOK_LPAREN, TOK_RPAREN,
     TOK_LBRACE, TOK_RBRACE,
     TOK_COLON, TOK_COMMA, TOK_SEMI, TOK_ASSIGN,
@@ -15,13 +17,22 @@ typedef enum {
     TOK_EQ, TOK_NEQ, TOK_LT, TOK_LTE, TOK_GT, TOK_GTE
 } TokenType;
 
+// Um token e uma visao (offset + tamanho) sobre o codigo fonte; nada e copiado.
+// Identificadores ja saem internados (`sym`, ver symtab.h). Para TOK_STRING a visao cobre o conteudo entre aspas, e `str` so e alocado
+// quando o literal tem escapes que precisam ser decodificados (dono: quem consome).
 typedef struct {
     TokenType type;
-    char text[256];
+    int start;
+    int length;
     int int_value;
+    int sym;
+    char *str;
+    int line, col;      // posicao do inicio, a partir de 1 (col em bytes)
 } Token;
 
 Token get_next_token(void);
 void init_lexer(const char *src);
+void init_lexer_source(Source *s);
+const char *token_text(const Token *tok);
 
-#endif
\ No newline at end of file
+#endif
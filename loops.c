@@ -0,0 +1,293 @@
+#include "loops.h"
+#include "symtab.h"
+#include <stdlib.h>
+
+// Variavel escrita dentro do laco (atribuicao, declaracao ou input).
+typedef struct {
+    int depth, slot;
+} Written;
+
+static _Thread_local Written *written;
+static _Thread_local int written_count, written_cap;
+static _Thread_local int loop_calls;          // o laco chama funcoes: globais podem mudar
+static _Thread_local AST *current_func;       // NULL no codigo de topo
+static _Thread_local Frames *frames;
+static _Thread_local int inv_sym;
+static _Thread_local AST **pre;               // declaracoes das invariantes do laco atual
+static _Thread_local int pre_count, pre_cap;
+
+static void add_written(int depth, int slot) {
+    for (int i = 0; i < written_count; i++)
+        if (written[i].depth == depth && written[i].slot == slot) return;
+    if (written_count == written_cap) {
+        written_cap = written_cap ? written_cap * 2 : 16;
+        written = realloc(written, sizeof(Written) * written_cap);
+    }
+    written[written_count].depth = depth;
+    written[written_count].slot = slot;
+    written_count++;
+}
+
+static int is_written(int depth, int slot) {
+    for (int i = 0; i < written_count; i++)
+        if (written[i].depth == depth && written[i].slot == slot) return 1;
+    return 0;
+}
+
+static void collect_written(AST *ast) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_PROGRAM:
+        case AST_CONCAT:
+            for (int i = 0; i < ast->list.count; i++) collect_written(ast->list.items[i]);
+            break;
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+            loop_calls = 1;
+            for (int i = 0; i < ast->list.count; i++) collect_written(ast->list.items[i]);
+            break;
+        case AST_AWAIT:
+            collect_written(ast->stmt.expr);
+            break;
+        case AST_VAR_DECL:
+        case AST_ASSIGN:
+            add_written(ast->depth, ast->stmt.slot);
+            collect_written(ast->stmt.expr);
+            break;
+        case AST_INPUT:
+            add_written(ast->depth, ast->var.slot);
+            break;
+        case AST_PRINT:
+        case AST_RETURN:
+            collect_written(ast->stmt.expr);
+            break;
+        case AST_BINOP:
+            collect_written(ast->bin.left);
+            collect_written(ast->bin.right);
+            break;
+        case AST_IF:
+            collect_written(ast->branch.cond);
+            collect_written(ast->branch.then_body);
+            collect_written(ast->branch.else_body);
+            break;
+        case AST_WHILE:
+        case AST_FOR:
+            collect_written(ast->loop.init);
+            collect_written(ast->loop.cond);
+            collect_written(ast->loop.incr);
+            collect_written(ast->loop.body);
+            break;
+        case AST_PARALLEL_FOR:
+            collect_written(ast->par.loop);
+            break;
+        default:
+            break;
+    }
+}
+
+// Mesmo valor em todas as voltas do laco? Expressoes nao tem efeitos alem das
+// chamadas, e divisao por zero nao interrompe, entao calcula-las antes (mesmo
+// que o laco nao rode) nao muda o programa.
+static int invariant(AST *e) {
+    switch (e->type) {
+        case AST_LITERAL:
+            return 1;
+        case AST_IDENTIFIER:
+            if (e->depth == SLOT_GLOBAL && loop_calls) return 0;
+            return !is_written(e->depth, e->var.slot);
+        case AST_BINOP:
+            return invariant(e->bin.left) && invariant(e->bin.right);
+        case AST_CONCAT:
+            for (int i = 0; i < e->list.count; i++)
+                if (!invariant(e->list.items[i])) return 0;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int new_slot(void) {
+    return current_func ? current_func->func.locals++ : frames->main_locals++;
+}
+
+// Troca `e` por uma leitura de um slot novo, declarado antes do laco.
+static AST *hoist(AST *e) {
+    int slot = new_slot();
+    AST *decl = ast_new(AST_VAR_DECL);
+    decl->vtype = e->vtype;
+    decl->line = e->line;
+    decl->col = e->col;
+    decl->depth = SLOT_LOCAL;
+    decl->sym = inv_sym;
+    decl->stmt.expr = e;
+    decl->stmt.type_sym = e->vtype == TYPE_STRING ? SYM_STRING : e->vtype == TYPE_BOOL ? SYM_BOOL : SYM_INT;
+    decl->stmt.slot = slot;
+    if (pre_count == pre_cap) {
+        pre_cap = pre_cap ? pre_cap * 2 : 8;
+        pre = realloc(pre, sizeof(AST*) * pre_cap);
+    }
+    pre[pre_count++] = decl;
+
+    AST *id = ast_new(AST_IDENTIFIER);
+    id->vtype = e->vtype;
+    id->depth = SLOT_LOCAL;
+    id->sym = inv_sym;
+    id->var.slot = slot;
+    return id;
+}
+
+// Substitui as maiores subexpressoes invariantes (operacoes, nao leituras
+// simples) sob *ref.
+static void hoist_expr(AST **ref) {
+    AST *e = *ref;
+    if (!e) return;
+    if ((e->type == AST_BINOP || e->type == AST_CONCAT) && e->vtype != TYPE_NONE && invariant(e)) {
+        *ref = hoist(e);
+        return;
+    }
+    switch (e->type) {
+        case AST_BINOP:
+            hoist_expr(&e->bin.left);
+            hoist_expr(&e->bin.right);
+            break;
+        case AST_CONCAT:
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+            for (int i = 0; i < e->list.count; i++) hoist_expr(&e->list.items[i]);
+            break;
+        default:
+            break;
+    }
+}
+
+static void hoist_stmt(AST *s) {
+    if (!s) return;
+    switch (s->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < s->list.count; i++) hoist_stmt(s->list.items[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_ASSIGN:
+        case AST_PRINT:
+        case AST_RETURN:
+            hoist_expr(&s->stmt.expr);
+            break;
+        case AST_FUNC_CALL:
+            for (int i = 0; i < s->list.count; i++) hoist_expr(&s->list.items[i]);
+            break;
+        case AST_IF:
+            hoist_expr(&s->branch.cond);
+            hoist_stmt(s->branch.then_body);
+            hoist_stmt(s->branch.else_body);
+            break;
+        case AST_WHILE:
+        case AST_FOR:
+            hoist_stmt(s->loop.init);
+            hoist_expr(&s->loop.cond);
+            hoist_stmt(s->loop.incr);
+            hoist_stmt(s->loop.body);
+            break;
+        default:
+            break;
+    }
+}
+
+static int is_local_var(AST *e, int slot) {
+    return e->type == AST_IDENTIFIER && e->depth == SLOT_LOCAL && e->var.slot == slot;
+}
+
+// `i < b; i = i + c` (ou <=, >, >=, !=; ou i - c) com i local, c literal nao
+// nulo, b literal ou local, e i escrito so no incremento.
+static int counted(AST *loop) {
+    AST *incr = loop->loop.incr, *cond = loop->loop.cond;
+    if (!incr || incr->type != AST_ASSIGN || incr->op == ASSIGN_APPEND) return 0;
+    if (incr->depth != SLOT_LOCAL || incr->vtype != TYPE_INT) return 0;
+    int slot = incr->stmt.slot;
+    AST *step = incr->stmt.expr;
+    if (step->type != AST_BINOP || (step->op != OP_ADD && step->op != OP_SUB)) return 0;
+    if (!is_local_var(step->bin.left, slot)) return 0;
+    if (step->bin.right->type != AST_LITERAL || step->bin.right->vtype != TYPE_INT || step->bin.right->lit.int_value == 0)
+        return 0;
+    if (!cond || cond->type != AST_BINOP || !is_local_var(cond->bin.left, slot)) return 0;
+    if (cond->op != OP_LT && cond->op != OP_LTE && cond->op != OP_GT && cond->op != OP_GTE && cond->op != OP_NEQ)
+        return 0;
+    AST *bound = cond->bin.right;
+    if (bound->vtype != TYPE_INT) return 0;
+    if (bound->type != AST_LITERAL && !(bound->type == AST_IDENTIFIER && bound->depth == SLOT_LOCAL)) return 0;
+    if (bound->type == AST_IDENTIFIER && (bound->var.slot == slot || is_written(SLOT_LOCAL, bound->var.slot)))
+        return 0;
+    // So o incremento pode escrever i.
+    written_count = 0;
+    collect_written(loop->loop.body);
+    collect_written(cond);
+    return !is_written(SLOT_LOCAL, slot);
+}
+
+static void loops_stmt(AST *s);
+
+static void optimize_for(AST *loop) {
+    written_count = 0;
+    loop_calls = 0;
+    collect_written(loop->loop.body);
+    collect_written(loop->loop.cond);
+    collect_written(loop->loop.incr);
+
+    int saved_pre = pre_count;
+    hoist_expr(&loop->loop.cond);
+    hoist_stmt(loop->loop.body);
+    if (pre_count > saved_pre) {
+        // As invariantes vem depois do init, que pode escrever o que elas leem.
+        int n = pre_count - saved_pre;
+        AST **items = malloc(sizeof(AST*) * (n + 1));
+        int k = 0;
+        if (loop->loop.init) items[k++] = loop->loop.init;
+        for (int i = 0; i < n; i++) items[k++] = pre[saved_pre + i];
+        loop->loop.init = ast_new_list(AST_PROGRAM, items, k);
+        free(items);
+        pre_count = saved_pre;
+    }
+
+    if (counted(loop)) loop->op = FOR_COUNTED;
+    loops_stmt(loop->loop.body);
+}
+
+static void loops_stmt(AST *s) {
+    if (!s) return;
+    switch (s->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < s->list.count; i++) loops_stmt(s->list.items[i]);
+            break;
+        case AST_FUNC_DECL:
+            current_func = s;
+            loops_stmt(s->func.body);
+            current_func = NULL;
+            break;
+        case AST_IF:
+            loops_stmt(s->branch.then_body);
+            loops_stmt(s->branch.else_body);
+            break;
+        case AST_WHILE:
+            loops_stmt(s->loop.body);
+            break;
+        case AST_FOR:
+            optimize_for(s);
+            break;
+        case AST_PARALLEL_FOR:
+            optimize_for(s->par.loop);
+            break;
+        default:
+            break;
+    }
+}
+
+void optimize_loops(AST *program, Frames *program_frames) {
+    frames = program_frames;
+    inv_sym = sym_intern("_inv", 4);
+    current_func = NULL;
+    loops_stmt(program);
+    free(written);
+    free(pre);
+    written = NULL;
+    pre = NULL;
+    written_count = written_cap = pre_count = pre_cap = 0;
+}
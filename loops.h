@@ -0,0 +1,15 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+#include "parser.h"
+#include "resolve.h"
+
+// Passe de lacos, depois do resolve (usa os slots). Em cada `for`:
+//  - subexpressoes invariantes (sem chamadas e sem ler variaveis escritas no
+//    laco) sao calculadas uma vez antes dele, num slot local novo;
+//  - lacos contados (`i < b; i = i + c`, com i local nao escrito no corpo,
+//    c constante e b invariante) sao marcados FOR_COUNTED e executados com
+//    a variavel de inducao como int, sem reavaliar a condicao pela via geral.
+// Os slots novos aumentam func.locals e frames->main_locals.
+void optimize_loops(AST *program, Frames *frames);
+
+#endif
@@ -0,0 +1,223 @@
+#include "macslang.h"
+#include "errors.h"
+#include "lexer.h"
+#include "parser.h"
+#include "typecheck.h"
+#include "optimize.h"
+#include "resolve.h"
+#include "loops.h"
+#include "symtab.h"
+#include "interpreter.h"
+#include "io.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Funcao do script visivel ao host; a tabela de simbolos da thread e solta
+// depois da carga, entao o nome e os tipos dos parametros sao copiados.
+typedef struct {
+    char *name;
+    int index;          // posicao entre as AST_FUNC_DECL (list.index)
+    int param_count;
+    int *param_types;   // SYM_INT, SYM_STRING, SYM_BOOL ou SYM_TASK
+} MacsFunc;
+
+struct MacsContext {
+    Arena arena;        // a AST do programa
+    AST *program;
+    Interp *interp;
+    MacsFunc *funcs;
+    int func_count;
+    int fd;
+    char *source;       // copia terminada em NUL, so durante a carga
+    char *error;
+    char *out;          // saida capturada (MACS_CAPTURE)
+    size_t out_len;
+    Value result;       // sustenta a string devolvida pela ultima chamada
+};
+
+static void set_error(MacsContext *ctx, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    free(ctx->error);
+    ctx->error = malloc(n + 1);
+    va_start(ap, fmt);
+    vsnprintf(ctx->error, n + 1, fmt, ap);
+    va_end(ap);
+}
+
+MacsContext *macs_new(void) {
+    MacsContext *ctx = calloc(1, sizeof(MacsContext));
+    ctx->fd = 1;
+    ctx->result = value_none();
+    return ctx;
+}
+
+void macs_free(MacsContext *ctx) {
+    if (!ctx) return;
+    if (ctx->interp) interp_free(ctx->interp);
+    arena_release(&ctx->arena);
+    for (int i = 0; i < ctx->func_count; i++) {
+        free(ctx->funcs[i].name);
+        free(ctx->funcs[i].param_types);
+    }
+    free(ctx->funcs);
+    free(ctx->error);
+    free(ctx->out);
+    value_free(ctx->result);
+    free(ctx);
+}
+
+void macs_set_output(MacsContext *ctx, int fd) {
+    ctx->fd = fd;
+}
+
+const char *macs_output(MacsContext *ctx, int *len) {
+    if (len) *len = (int)ctx->out_len;
+    return ctx->out ? ctx->out : "";
+}
+
+// Liga a saida do contexto a E/S da thread durante uma execucao.
+static void bind_output(MacsContext *ctx) {
+    io_bind(ctx->fd);
+}
+
+static void release_output(MacsContext *ctx) {
+    size_t len;
+    char *text = io_release(&len);
+    if (!text) return;
+    ctx->out = realloc(ctx->out, ctx->out_len + len + 1);
+    memcpy(ctx->out + ctx->out_len, text, len);
+    ctx->out_len += len;
+    ctx->out[ctx->out_len] = '\0';
+    free(text);
+}
+
+const char *macs_error(MacsContext *ctx) {
+    return ctx->error ? ctx->error : "";
+}
+
+static void collect_funcs(MacsContext *ctx, AST *program) {
+    ctx->funcs = malloc(sizeof(MacsFunc) * (program->list.count + 1));
+    int index = 0;
+    for (int i = 0; i < program->list.count; i++) {
+        AST *decl = program->list.items[i];
+        if (decl->type != AST_FUNC_DECL) continue;
+        MacsFunc *f = &ctx->funcs[ctx->func_count++];
+        f->name = strdup(sym_name(decl->sym));
+        f->index = index++;
+        f->param_count = decl->func.params_count;
+        f->param_types = malloc(sizeof(int) * (f->param_count + 1));
+        for (int p = 0; p < f->param_count; p++) f->param_types[p] = decl->func.params[p].type;
+    }
+}
+
+int macs_load(MacsContext *ctx, const char *source, int len) {
+    if (ctx->program) {
+        set_error(ctx, "Context already has a program\n");
+        return -1;
+    }
+    ctx->source = malloc(len + 1);
+    memcpy(ctx->source, source, len);
+    ctx->source[len] = '\0';
+
+    // Os passes de analise reportam erros por error_printf/error_exit: com a
+    // armadilha armada, um erro volta aqui em vez de encerrar o processo.
+    ErrorTrap trap = { 0 };
+    error_trap = &trap;
+    if (setjmp(trap.jump)) {
+        error_trap = NULL;
+        free_ast(NULL);
+        sym_free();
+        free(ctx->source);
+        ctx->source = NULL;
+        free(ctx->error);
+        ctx->error = trap.text ? trap.text : strdup("Parsing failed.\n");
+        return -1;
+    }
+    init_lexer(ctx->source);
+    AST *program = parse_program();
+    if (!program) {
+        error_printf("Parsing failed.\n");
+        error_exit();
+    }
+    if (typecheck(program) > 0) error_exit();
+    optimize(program);
+    Frames frames = resolve(program);
+    optimize_loops(program, &frames);
+    error_trap = NULL;
+    free(trap.text);
+    free(ctx->source);
+    ctx->source = NULL;
+
+    collect_funcs(ctx, program);
+    ast_take_arena(&ctx->arena);
+    sym_free();
+    ctx->program = program;
+    ctx->interp = interp_new(program, frames);
+    // O cache de memo e o JIT sao globais da thread: ficam para a CLI.
+    interp_set_memo(ctx->interp, 0);
+
+    bind_output(ctx);
+    interp_run(ctx->interp, program);
+    release_output(ctx);
+    return 0;
+}
+
+static MacsFunc *find_func(MacsContext *ctx, const char *name) {
+    // Como no interpretador, a ultima declaracao de um nome prevalece.
+    for (int i = ctx->func_count - 1; i >= 0; i--)
+        if (strcmp(ctx->funcs[i].name, name) == 0) return &ctx->funcs[i];
+    return NULL;
+}
+
+static const char *type_name(int type_sym) {
+    return type_sym == SYM_INT ? "int" : type_sym == SYM_STRING ? "string" : type_sym == SYM_BOOL ? "bool" : "task";
+}
+
+int macs_call(MacsContext *ctx, const char *name, const MacsValue *args, int nargs, MacsValue *result) {
+    if (!ctx->interp) {
+        set_error(ctx, "No program loaded\n");
+        return -1;
+    }
+    MacsFunc *f = find_func(ctx, name);
+    if (!f) {
+        set_error(ctx, "Undefined function: %s\n", name);
+        return -1;
+    }
+    if (nargs != f->param_count) {
+        set_error(ctx, "Function %s expects %d arguments, got %d\n", name, f->param_count, nargs);
+        return -1;
+    }
+    Value *values = malloc(sizeof(Value) * (nargs + 1));
+    for (int i = 0; i < nargs; i++) {
+        int type = f->param_types[i];
+        if (type == SYM_INT && args[i].type == MACS_INT) values[i] = value_int(args[i].i);
+        else if (type == SYM_BOOL && args[i].type == MACS_BOOL) values[i] = value_bool(args[i].i);
+        else if (type == SYM_STRING && args[i].type == MACS_STRING) values[i] = value_str(str_new(args[i].s, args[i].len));
+        else {
+            for (int k = 0; k < i; k++) value_free(values[k]);
+            free(values);
+            set_error(ctx, "Argument %d of %s must be %s\n", i + 1, name, type_name(type));
+            return -1;
+        }
+    }
+
+    bind_output(ctx);
+    Value ret = interp_call(ctx->interp, f->index, values);
+    release_output(ctx);
+    for (int i = 0; i < nargs; i++) value_free(values[i]);
+    free(values);
+
+    value_free(ctx->result);
+    ctx->result = ret;
+    MacsValue out = { MACS_NONE, 0, 0, 0 };
+    if (ret.type == VAL_INT) out = macs_int(ret.int_val);
+    else if (ret.type == VAL_BOOL) out = macs_bool(ret.bool_val);
+    else if (ret.type == VAL_STRING) out = macs_string(ret.str->chars, ret.str->len);
+    if (result) *result = out;
+    return 0;
+}
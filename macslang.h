@@ -0,0 +1,66 @@
+#ifndef MACSLANG_H
+#define MACSLANG_H
+
+// API para embutir MACSLang num programa C (libmacslang). Cada MacsContext
+// guarda um programa ja analisado e o estado da sua execucao: carrega-se uma
+// vez e chamam-se as funcoes do script quantas vezes quiser. Contextos
+// diferentes podem rodar ao mesmo tempo em threads diferentes, sem travas;
+// um mesmo contexto deve ser usado por uma thread de cada vez.
+//
+//     MacsContext *ctx = macs_new();
+//     if (macs_load(ctx, src, len) != 0) fprintf(stderr, "%s", macs_error(ctx));
+//     MacsValue arg = macs_int(10), result;
+//     if (macs_call(ctx, "fib", &arg, 1, &result) == 0) printf("%d\n", result.i);
+//     macs_free(ctx);
+
+typedef struct MacsContext MacsContext;
+
+typedef enum {
+    MACS_NONE,
+    MACS_INT,
+    MACS_STRING,
+    MACS_BOOL
+} MacsType;
+
+typedef struct {
+    MacsType type;
+    int i;              // MACS_INT e MACS_BOOL
+    const char *s;      // MACS_STRING: nao precisa terminar em NUL
+    int len;
+} MacsValue;
+
+static inline MacsValue macs_int(int v) {
+    MacsValue val = { MACS_INT, v, 0, 0 };
+    return val;
+}
+
+static inline MacsValue macs_bool(int v) {
+    MacsValue val = { MACS_BOOL, !!v, 0, 0 };
+    return val;
+}
+
+static inline MacsValue macs_string(const char *s, int len) {
+    MacsValue val = { MACS_STRING, 0, s, len };
+    return val;
+}
+
+MacsContext *macs_new(void);
+void macs_free(MacsContext *ctx);
+// Descritor que recebe os prints do script (padrao: 1). Com MACS_CAPTURE
+// a saida fica em memoria e e lida com macs_output.
+#define MACS_CAPTURE (-1)
+void macs_set_output(MacsContext *ctx, int fd);
+// Saida acumulada desde a carga com MACS_CAPTURE (len bytes, terminada em
+// NUL); vale ate a proxima chamada no contexto.
+const char *macs_output(MacsContext *ctx, int *len);
+// Analisa `source` (len bytes) e executa o codigo de topo. Devolve 0 ou -1
+// com a mensagem em macs_error. Um contexto carrega um unico programa.
+int macs_load(MacsContext *ctx, const char *source, int len);
+// Chama a funcao `name` do script. Os argumentos precisam ter os tipos dos
+// parametros. Uma string em *result vale ate a proxima chamada no contexto.
+// Devolve 0 ou -1 (funcao inexistente, aridade ou tipo errado).
+int macs_call(MacsContext *ctx, const char *name, const MacsValue *args, int nargs, MacsValue *result);
+// Ultimo erro do contexto ("" se nenhum).
+const char *macs_error(MacsContext *ctx);
+
+#endif
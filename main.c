@@ -1,44 +1,330 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "vm.h"
+#include "optimize.h"
+#include "typecheck.h"
+#include "resolve.h"
+#include "symtab.h"
+#include "scan.h"
+#include "io.h"
+#include "jit.h"
+#include "emitc.h"
+#include "memo.h"
+#include "profile.h"
+#include "loops.h"
+#include "cache.h"
+#include "batch.h"
+#include "pool.h"
+#include <fcntl.h>
+
+#define OUTPUT_FILE_BUFFER (1024 * 1024)
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double lex_pass(Source *source, long *count) {
+    double t0 = now_seconds();
+    init_lexer_source(source);
+    *count = 0;
+    while (1) {
+        Token tok = get_next_token();
+        free(tok.str);
+        if (tok.type == TOK_EOF) break;
+        (*count)++;
+    }
+    return now_seconds() - t0;
+}
+
+// Apenas tokeniza o arquivo e reporta a vazao do lexer.
+static void lex_stats(Source *source) {
+    long count;
+    double elapsed = lex_pass(source, &count);
+    printf("tokens: %ld\n", count);
+    printf("time: %.6f s\n", elapsed);
+    if (elapsed > 0)
+        printf("throughput: %.0f tokens/s\n", count / elapsed);
+}
+
+// Micro-benchmark do lexer: mede cada modo de varredura suportado pela CPU
+// (melhor de varias passagens) e compara com o caminho escalar.
+static void bench_lex(Source *source) {
+    double size = (double)source->len;
+    ScanMode modes[] = { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+    double scalar_time = 0;
+    long count = 0;
+    lex_pass(source, &count); // aquece a tabela de simbolos
+    for (int m = 0; m < 3; m++) {
+        if (!scan_supported(modes[m])) continue;
+        scan_select(modes[m]);
+        double best = 1e30;
+        for (int rep = 0; rep < 5; rep++) {
+            double t = lex_pass(source, &count);
+            if (t < best) best = t;
+        }
+        if (modes[m] == SCAN_SCALAR) scalar_time = best;
+        printf("%-7s %10.0f tokens/s %8.1f MB/s  %.2fx\n", scan_mode_name(modes[m]),
+               count / best, size / best / 1e6, scalar_time / best);
+    }
+}
 
 int main(int argc, char **argv) {
-    if (argc < 2) {
-        printf("Usage: %s <file.macslang>\n", argv[0]);
+    const char *path = NULL, *output = NULL, *binary = NULL, *cache_dir = NULL, *manifest = NULL, *folded = NULL;
+    char **paths = malloc(sizeof(char*) * argc);
+    int path_count = 0, jobs = -1, threads = 0;
+    long out_size = -1;
+    int jit_threshold = JIT_DEFAULT_THRESHOLD;
+    int only_lex = 0, bench = 0, use_vm = 0, opt = 1, dump = 0, emit = 0, build = 0, memo_stats = 0, use_cache = 1;
+    ScanMode scan_mode = SCAN_AUTO;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lex-stats") == 0) only_lex = 1;
+        else if (strcmp(argv[i], "--bench-lex") == 0) bench = 1;
+        else if (strcmp(argv[i], "--dump-ast") == 0) dump = 1;
+        else if (strcmp(argv[i], "--no-opt") == 0) opt = 0;
+        else if (strcmp(argv[i], "--engine=vm") == 0) use_vm = 1;
+        else if (strcmp(argv[i], "--engine=tree") == 0) use_vm = 0;
+        else if (strcmp(argv[i], "--scan=scalar") == 0) scan_mode = SCAN_SCALAR;
+        else if (strcmp(argv[i], "--scan=sse2") == 0) scan_mode = SCAN_SSE2;
+        else if (strcmp(argv[i], "--scan=avx2") == 0) scan_mode = SCAN_AVX2;
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) output = argv[++i];
+        else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) cache_dir = argv[++i];
+        else if (strcmp(argv[i], "--no-cache") == 0) use_cache = 0;
+        else if (strncmp(argv[i], "--output-buffer=", 16) == 0) out_size = atol(argv[i] + 16);
+        else if (strcmp(argv[i], "--jit") == 0) jit_enabled = 1;
+        else if (strncmp(argv[i], "--jit-threshold=", 16) == 0) { jit_enabled = 1; jit_threshold = atoi(argv[i] + 16); }
+        else if (strcmp(argv[i], "--no-memo") == 0) memo_enabled = 0;
+        else if (strcmp(argv[i], "--no-quicken") == 0) quicken_enabled = 0;
+        else if (strcmp(argv[i], "--memo-stats") == 0) memo_stats = 1;
+        else if (strcmp(argv[i], "--emit-c") == 0) emit = 1;
+        else if (strcmp(argv[i], "--build") == 0) build = 1;
+        else if (strncmp(argv[i], "--build=", 8) == 0) { build = 1; binary = argv[i] + 8; }
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) manifest = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--profile") == 0) profile_enabled = 1;
+        else if (strcmp(argv[i], "--folded") == 0 && i + 1 < argc) { profile_enabled = 1; folded = argv[++i]; }
+        else path = paths[path_count++] = argv[i];
+    }
+
+    // Antes do lote: os trabalhadores leem o modo em scan_init.
+    scan_select(scan_mode);
+
+    // Lote: todos os arquivos (da linha de comando e do manifesto) num so
+    // processo, em --jobs trabalhadores (0: um por processador).
+    if (jobs >= 0 || manifest) {
+        // Os scripts do lote rodam pela API embutida (macs_load): otimizados,
+        // no interpretador de arvore e com parallel for em sequencia.
+        const char *fixed = !opt ? "--no-opt" : use_vm ? "--engine=vm" : jit_enabled ? "--jit" :
+                            profile_enabled ? "--profile" : threads ? "--threads" : memo_stats ? "--memo-stats" :
+                            emit ? "--emit-c" : build ? "--build" : dump ? "--dump-ast" :
+                            only_lex ? "--lex-stats" : bench ? "--bench-lex" : NULL;
+        if (fixed) {
+            printf("%s cannot be used with --jobs\n", fixed);
+            free(paths);
+            return 1;
+        }
+        char **list = paths;
+        int count = path_count;
+        if (manifest) {
+            char **listed;
+            int n = batch_read_manifest(manifest, &listed);
+            if (n < 0) {
+                printf("Could not open manifest: %s\n", manifest);
+                free(paths);
+                return 1;
+            }
+            list = malloc(sizeof(char*) * (path_count + n + 1));
+            memcpy(list, paths, sizeof(char*) * path_count);
+            memcpy(list + path_count, listed, sizeof(char*) * n);
+            count = path_count + n;
+            free(listed);
+        }
+        FILE *out = output ? fopen(output, "w") : stdout;
+        int status = 1;
+        if (!out) {
+            printf("Could not open output file: %s\n", output);
+        } else {
+            status = batch_run(list, count, jobs, out);
+            if (out != stdout) fclose(out);
+        }
+        for (int i = path_count; i < count; i++) free(list[i]);
+        if (list != paths) free(list);
+        free(paths);
+        return status;
+    }
+    free(paths);
+    parallel_threads = threads > 0 ? threads : pool_cpu_count();
+    // O profiler mede o interpretador de arvore, numa thread e sem JIT.
+    if (profile_enabled) {
+        use_vm = 0;
+        jit_enabled = 0;
+        parallel_threads = 1;
+    }
+    if (!path) {
+        printf("Usage: %s [--engine=tree|vm] [--no-opt] [--dump-ast] [--lex-stats] [--bench-lex] [--scan=scalar|sse2|avx2] [--output FILE] [--output-buffer=BYTES] [--cache-dir DIR] [--no-cache] [--jit] [--jit-threshold=N] [--no-memo] [--memo-stats] [--no-quicken] [--emit-c] [--build[=BIN]] [--jobs N] [--manifest FILE] [--threads N] [--profile] [--folded FILE] <file.macslang | -> [files... with --jobs]\n", argv[0]);
         return 1;
     }
 
-    FILE *f = fopen(argv[1], "r");
-    if (!f) {
-        printf("Could not open file: %s\n", argv[1]);
+    // "-" le o programa de stdin em blocos; arquivos regulares sao mapeados.
+    Source source;
+    if (strcmp(path, "-") == 0) {
+        source_open_stream(&source, 0);
+    } else if (source_open_file(&source, path) != 0) {
+        printf("Could not open file: %s\n", path);
         return 1;
     }
 
-    fseek(f, 0, SEEK_END);
-    long sz = ftell(f);
-    rewind(f);
+    if (bench) {
+        if (!source.map_len) {
+            printf("--bench-lex needs a regular file\n");
+            source_close(&source);
+            return 1;
+        }
+        bench_lex(&source);
+        source_close(&source);
+        return 0;
+    }
 
-    char *source = malloc(sz + 1);
-    fread(source, 1, sz, f);
-    source[sz] = '\0';
-    fclose(f);
+    if (only_lex) {
+        printf("scan: %s\n", scan_mode_name(scan_select(scan_mode)));
+        lex_stats(&source);
+        source_close(&source);
+        return 0;
+    }
 
-    init_lexer(source);
-    AST *program = parse_program();
+    // Programas em arquivo passam pelo cache em disco: um acerto entrega a
+    // AST ja verificada e otimizada, sem lexer nem parser.
+    AST *program = NULL;
+    CacheImage image = { 0 };
+    char *cache_file = NULL;
+    if (use_cache && source.map_len) {
+        char *dir = cache_dir ? strdup(cache_dir) : cache_default_dir();
+        if (dir) {
+            cache_file = cache_path(dir, source.data, source.len, opt);
+            program = cache_load(cache_file, source.data, source.len, opt, &image);
+            free(dir);
+        }
+    }
 
     if (!program) {
-        printf("Parsing failed.\n");
-        free(source);
-        return 1;
+        init_lexer_source(&source);
+        program = parse_program();
+
+        if (!program) {
+            printf("Parsing failed.\n");
+            source_close(&source);
+            return 1;
+        }
+
+        if (typecheck(program) > 0) {
+            source_close(&source);
+            free_ast(program);
+            sym_free();
+            return 1;
+        }
+
+        if (opt) optimize(program);
+        if (cache_file) cache_store(cache_file, program, source.data, source.len, opt);
+    }
+    source_close(&source);
+    free(cache_file);
+
+    if (dump) {
+        dump_ast(program);
+        free_ast(program);
+        cache_unload(&image);
+        sym_free();
+        return 0;
     }
 
-    init_vars();
-    interpret(program);
+    // Traducao para C: --emit-c escreve o fonte (em stdout ou no arquivo de
+    // --output); --build compila com o cc local, por padrao no nome do
+    // programa sem a extensao.
+    if (emit || build) {
+        int status = 0;
+        resolve(program);
+        if (build) {
+            char *name = NULL;
+            if (!binary) {
+                size_t len = strlen(path);
+                if (len > 9 && strcmp(path + len - 9, ".macslang") == 0)
+                    binary = name = strndup(path, len - 9);
+                else
+                    binary = "a.out";
+            }
+            status = emit_c_build(program, binary);
+            if (status) printf("Build failed: %s\n", binary);
+            free(name);
+        } else {
+            FILE *out = output ? fopen(output, "w") : stdout;
+            if (!out) {
+                printf("Could not open output file: %s\n", output);
+                status = 1;
+            } else {
+                emit_c(program, out);
+                if (out != stdout) fclose(out);
+            }
+        }
+        free_ast(program);
+        cache_unload(&image);
+        sym_free();
+        return status;
+    }
+
+    // Saida do programa: buffer proprio, descarregado com write(2). Para
+    // arquivo o buffer padrao e maior, ja que ninguem espera linha a linha.
+    int out_fd = 1;
+    if (output) {
+        out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) {
+            printf("Could not open output file: %s\n", output);
+            return 1;
+        }
+    }
+    if (out_size < 0) out_size = output ? OUTPUT_FILE_BUFFER : IO_DEFAULT_BUFFER;
+    io_init_output(out_fd, (size_t)out_size);
+
+    Frames frames = resolve(program);
+    if (opt) optimize_loops(program, &frames);
+    memo_init(program);
+    if (jit_enabled) jit_init(program, jit_threshold);
+    if (profile_enabled) profile_init(program);
+    if (use_vm) {
+        Bytecode *bc = vm_compile(program, frames);
+        vm_run(bc);
+        vm_free(bc);
+    } else {
+        interpret(program, frames);
+    }
+    if (jit_enabled) jit_free();
+    if (memo_stats) {
+        io_flush();
+        memo_report(stderr);
+    }
+    memo_free();
+    if (profile_enabled) {
+        io_flush();
+        profile_report(stderr);
+        FILE *out = folded ? fopen(folded, "w") : NULL;
+        if (out) {
+            profile_folded(out);
+            fclose(out);
+        } else if (folded) {
+            fprintf(stderr, "Could not open folded output file: %s\n", folded);
+        }
+        profile_free();
+    }
 
     free_ast(program);
-    free(source);
+    cache_unload(&image);
+    sym_free();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,234 @@
+#include "memo.h"
+#include "symtab.h"
+#include <stdlib.h>
+#include <string.h>
+
+_Thread_local int memo_enabled = 1;
+_Thread_local unsigned char *memo_funcs;
+
+typedef struct {
+    AST *decl;
+    int pure;
+    int nargs;
+    Value *keys;            // MEMO_SLOTS * nargs, alocado no primeiro resultado
+    Value *results;
+    unsigned char *used;
+    long calls, hits;
+    int entries;
+    int gave_up;            // poucos acertos: o cache foi desligado
+} MemoFunc;
+
+// Argumentos das chamadas em andamento que nao acharam resultado, em pilha
+// (as chamadas terminam na ordem inversa em que comecam).
+typedef struct {
+    unsigned int hash;
+    Value args[MEMO_MAX_ARGS];
+} Pending;
+
+static _Thread_local MemoFunc *mfuncs;
+static _Thread_local int mfunc_count;
+static _Thread_local Pending *pending;
+static _Thread_local int pending_count, pending_cap;
+
+// ---- Analise ----
+
+// Corpo sem print/input, sem acessar globais e chamando so funcoes ainda
+// marcadas puras. `work` conta chamadas e lacos: sem eles o cache nao paga.
+static int body_pure(AST *ast, int *work) {
+    if (!ast) return 1;
+    switch (ast->type) {
+        case AST_PRINT:
+        case AST_INPUT:
+            return 0;
+        case AST_IDENTIFIER:
+            return ast->depth == SLOT_LOCAL;
+        case AST_LITERAL:
+        case AST_FUNC_DECL:
+            return 1;
+        case AST_VAR_DECL:
+        case AST_ASSIGN:
+            if (ast->depth != SLOT_LOCAL) return 0;
+            return body_pure(ast->stmt.expr, work);
+        case AST_RETURN:
+            return body_pure(ast->stmt.expr, work);
+        case AST_FUNC_CALL:
+            if (!mfuncs[ast->list.index].pure) return 0;
+            (*work)++;
+            /* fallthrough */
+        case AST_PROGRAM:
+        case AST_CONCAT:
+            for (int i = 0; i < ast->list.count; i++)
+                if (!body_pure(ast->list.items[i], work)) return 0;
+            return 1;
+        case AST_BINOP:
+            return body_pure(ast->bin.left, work) && body_pure(ast->bin.right, work);
+        case AST_IF:
+            return body_pure(ast->branch.cond, work) && body_pure(ast->branch.then_body, work) &&
+                   body_pure(ast->branch.else_body, work);
+        case AST_WHILE:
+        case AST_FOR:
+            (*work)++;
+            return body_pure(ast->loop.init, work) && body_pure(ast->loop.cond, work) &&
+                   body_pure(ast->loop.incr, work) && body_pure(ast->loop.body, work);
+        default:
+            return 0;
+    }
+}
+
+void memo_init(AST *program) {
+    mfuncs = calloc(program->list.count + 1, sizeof(MemoFunc));
+    memo_funcs = calloc(program->list.count + 1, 1);
+    mfunc_count = 0;
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type != AST_FUNC_DECL) continue;
+        mfuncs[mfunc_count].decl = stmt;
+        mfuncs[mfunc_count].nargs = stmt->func.params_count;
+        mfuncs[mfunc_count].pure = stmt->func.params_count <= MEMO_MAX_ARGS && stmt->func.type_sym != SYM_TASK;
+        // Handles de spawn nao servem de chave.
+        for (int p = 0; p < stmt->func.params_count; p++)
+            if (stmt->func.params[p].type == SYM_TASK) mfuncs[mfunc_count].pure = 0;
+        mfunc_count++;
+    }
+    // Parte de todas puras e desmarca quem quebra as regras ate estabilizar,
+    // para que recursao (inclusive mutua) entre funcoes puras continue pura.
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < mfunc_count; i++) {
+            int work = 0;
+            if (mfuncs[i].pure && !body_pure(mfuncs[i].decl->func.body, &work)) {
+                mfuncs[i].pure = 0;
+                changed = 1;
+            }
+        }
+    }
+    if (!memo_enabled) return;
+    for (int i = 0; i < mfunc_count; i++) {
+        int work = 0;
+        if (mfuncs[i].pure && body_pure(mfuncs[i].decl->func.body, &work) && work > 0)
+            memo_funcs[i] = 1;
+    }
+}
+
+// ---- Cache ----
+
+// Argumentos inteiros consecutivos caem em entradas consecutivas, entao a
+// recursao tipica (fib(n - 1), fib(n - 2)) nao colide.
+static unsigned int hash_args(const Value *args, int n) {
+    unsigned int h = 0;
+    for (int i = 0; i < n; i++) {
+        unsigned int v;
+        if (args[i].type == VAL_STRING) {
+            v = 2166136261u;
+            for (int c = 0; c < args[i].str->len; c++)
+                v = (v ^ (unsigned char)args[i].str->chars[c]) * 16777619u;
+        } else if (args[i].type == VAL_NONE) {
+            v = 0x9e3779b9u;
+        } else {
+            v = (unsigned int)args[i].int_val;
+        }
+        h = h * 31 + v;
+    }
+    return h;
+}
+
+static int same_value(Value a, Value b) {
+    if (a.type != b.type) return 0;
+    if (a.type == VAL_STRING)
+        return a.str == b.str || (a.str->len == b.str->len && memcmp(a.str->chars, b.str->chars, a.str->len) == 0);
+    if (a.type == VAL_NONE) return 1;
+    return a.int_val == b.int_val;
+}
+
+int memo_lookup(int index, const Value *args, Value *out) {
+    MemoFunc *f = &mfuncs[index];
+    unsigned int hash = hash_args(args, f->nargs);
+    unsigned int slot = hash & (MEMO_SLOTS - 1);
+    f->calls++;
+    if (f->used && f->used[slot]) {
+        Value *keys = &f->keys[(size_t)slot * f->nargs];
+        int i = 0;
+        while (i < f->nargs && same_value(keys[i], args[i])) i++;
+        if (i == f->nargs) {
+            f->hits++;
+            *out = value_copy(f->results[slot]);
+            return 1;
+        }
+    }
+    // Com argumentos quase sempre novos o cache so custa: desliga a funcao
+    // (as chamadas ja em andamento ainda passam por memo_finish).
+    if (f->calls >= MEMO_PROBE_CALLS && f->hits * MEMO_MIN_HIT_RATIO < f->calls) {
+        memo_funcs[index] = 0;
+        f->gave_up = 1;
+    }
+    if (pending_count == pending_cap) {
+        pending_cap = pending_cap ? pending_cap * 2 : 64;
+        pending = realloc(pending, sizeof(Pending) * pending_cap);
+    }
+    Pending *p = &pending[pending_count++];
+    p->hash = hash;
+    for (int i = 0; i < f->nargs; i++) p->args[i] = value_copy(args[i]);
+    return 0;
+}
+
+void memo_finish(int index, Value result) {
+    MemoFunc *f = &mfuncs[index];
+    Pending *p = &pending[--pending_count];
+    if (!f->used) {
+        f->keys = malloc(sizeof(Value) * MEMO_SLOTS * (f->nargs ? f->nargs : 1));
+        f->results = malloc(sizeof(Value) * MEMO_SLOTS);
+        f->used = calloc(MEMO_SLOTS, 1);
+    }
+    // Uma entrada por posicao: o resultado novo substitui o antigo.
+    unsigned int slot = p->hash & (MEMO_SLOTS - 1);
+    Value *keys = &f->keys[(size_t)slot * f->nargs];
+    if (f->used[slot]) {
+        for (int i = 0; i < f->nargs; i++) value_free(keys[i]);
+        value_free(f->results[slot]);
+    } else {
+        f->used[slot] = 1;
+        f->entries++;
+    }
+    memcpy(keys, p->args, sizeof(Value) * f->nargs);
+    f->results[slot] = value_copy(result);
+}
+
+void memo_report(FILE *out) {
+    if (!memo_enabled) {
+        fprintf(out, "memo: disabled (--no-memo)\n");
+        return;
+    }
+    fprintf(out, "memo: %-20s %12s %12s %8s %8s\n", "function", "calls", "hits", "hit%", "entries");
+    for (int i = 0; i < mfunc_count; i++) {
+        MemoFunc *f = &mfuncs[i];
+        if (!memo_funcs[i] && !f->gave_up) {
+            if (f->pure) fprintf(out, "memo: %-20s (pure, not cached: no calls or loops)\n", sym_name(f->decl->sym));
+            continue;
+        }
+        fprintf(out, "memo: %-20s %12ld %12ld %7.1f%% %8d%s\n", sym_name(f->decl->sym), f->calls, f->hits,
+                f->calls ? 100.0 * f->hits / f->calls : 0.0, f->entries, f->gave_up ? "  (off: low hit rate)" : "");
+    }
+}
+
+void memo_free(void) {
+    for (int i = 0; i < mfunc_count; i++) {
+        MemoFunc *f = &mfuncs[i];
+        if (!f->used) continue;
+        for (int s = 0; s < MEMO_SLOTS; s++) {
+            if (!f->used[s]) continue;
+            for (int a = 0; a < f->nargs; a++) value_free(f->keys[(size_t)s * f->nargs + a]);
+            value_free(f->results[s]);
+        }
+        free(f->keys);
+        free(f->results);
+        free(f->used);
+    }
+    free(mfuncs);
+    free(memo_funcs);
+    free(pending);
+    mfuncs = NULL;
+    memo_funcs = NULL;
+    pending = NULL;
+    mfunc_count = pending_count = pending_cap = 0;
+}
@@ -0,0 +1,38 @@
+#ifndef MEMO_H
+#define MEMO_H
+#include <stdio.h>
+#include "parser.h"
+#include "value.h"
+
+// Memoizacao automatica de funcoes puras: sem print/input, sem ler nem
+// escrever globais e chamando so funcoes puras. Cada uma dessas funcoes que
+// chama outra funcao ou tem laco ganha um cache de tamanho fixo, indexado
+// pelos argumentos; funcoes folha sem laco saem mais baratas recalculadas.
+// Ligada por padrao (--no-memo desliga); --memo-stats mostra os acertos.
+// Uma funcao cujo cache acerta menos de 1 em MEMO_MIN_HIT_RATIO chamadas
+// depois de MEMO_PROBE_CALLS chamadas volta a ser sempre executada.
+
+#define MEMO_SLOTS 4096     // entradas por funcao (potencia de 2)
+#define MEMO_MAX_ARGS 16
+#define MEMO_PROBE_CALLS 4096
+#define MEMO_MIN_HIT_RATIO 8
+
+// Analisa as funcoes do programa ja resolvido (list.index de cada chamada).
+void memo_init(AST *program);
+// Procura o resultado da funcao `index` para `args`. No acerto devolve 1 e
+// uma referencia nova em *out; na falta guarda uma copia dos argumentos, que
+// o memo_finish da mesma chamada usa para gravar o resultado.
+int memo_lookup(int index, const Value *args, Value *out);
+// Grava o resultado da chamada mais recente sem acerto (sem consumi-lo).
+void memo_finish(int index, Value result);
+void memo_report(FILE *out);
+void memo_free(void);
+
+extern _Thread_local int memo_enabled;
+extern _Thread_local unsigned char *memo_funcs;  // index -> 1 se a funcao tem cache
+
+static inline int memo_active(int index) {
+    return memo_funcs && memo_funcs[index];
+}
+
+#endif
@@ -0,0 +1,258 @@
+#include "optimize.h"
+#include "value.h"
+#include <stdlib.h>
+#include <string.h>
+
+static AST* fold_expr(AST *ast);
+static AST* optimize_stmt(AST *ast);
+
+static Value literal_value(AST *lit) {
+    if (lit->vtype == TYPE_STRING) return value_str(lit->lit.str_value);
+    if (lit->vtype == TYPE_BOOL) return value_bool(lit->lit.int_value);
+    return value_int(lit->lit.int_value);
+}
+
+// Cria um literal com o valor dado; consome `v`.
+static AST* make_literal(Value v) {
+    AST *lit = ast_new(AST_LITERAL);
+    if (v.type == VAL_STRING) {
+        lit->vtype = TYPE_STRING;
+        lit->lit.str_value = ast_str(v.str->chars, v.str->len);
+        value_free(v);
+    } else if (v.type == VAL_BOOL) {
+        lit->vtype = TYPE_BOOL;
+        lit->lit.int_value = v.bool_val;
+    } else {
+        lit->vtype = TYPE_INT;
+        lit->lit.int_value = v.int_val;
+    }
+    return lit;
+}
+
+static int is_literal(AST *ast) {
+    return ast && ast->type == AST_LITERAL;
+}
+
+static int literal_truth(AST *lit) {
+    if (lit->vtype == TYPE_STRING) return lit->lit.str_value->len > 0;
+    return lit->lit.int_value != 0;
+}
+
+typedef struct {
+    AST **items;
+    int count, cap;
+} Parts;
+
+static void parts_push(Parts *p, AST *ast) {
+    if (p->count == p->cap) {
+        p->cap = p->cap ? p->cap * 2 : 8;
+        p->items = realloc(p->items, sizeof(AST*) * p->cap);
+    }
+    p->items[p->count++] = ast;
+}
+
+// Operandos de uma cadeia de + entre strings, da esquerda para a direita.
+// O texto do resultado e a juncao dos textos dos operandos.
+static void collect_concat(AST *ast, Parts *p) {
+    if (ast->type == AST_CONCAT) {
+        for (int i = 0; i < ast->list.count; i++) parts_push(p, ast->list.items[i]);
+    } else if (ast->type == AST_BINOP && ast->op == OP_ADD && ast->vtype == TYPE_STRING) {
+        collect_concat(ast->bin.left, p);
+        collect_concat(ast->bin.right, p);
+    } else {
+        parts_push(p, ast);
+    }
+}
+
+// Troca uma cadeia de + entre strings por um AST_CONCAT, juntando literais
+// vizinhos pelo texto (`s + 1 + 2` vira s seguido de "12").
+static AST* flatten_concat(AST *ast) {
+    Parts p = { NULL, 0, 0 };
+    collect_concat(ast, &p);
+    int n = 0;
+    for (int i = 0; i < p.count; i++) {
+        AST *part = p.items[i];
+        if (n > 0 && is_literal(p.items[n - 1]) && is_literal(part)) {
+            Value pair[2] = { literal_value(p.items[n - 1]), literal_value(part) };
+            p.items[n - 1] = make_literal(value_concat(pair, 2));
+        } else {
+            p.items[n++] = part;
+        }
+    }
+    AST *result = n == 1 ? p.items[0] : ast_new_list(AST_CONCAT, p.items, n);
+    result->vtype = TYPE_STRING;
+    free(p.items);
+    return result;
+}
+
+static AST* fold_expr(AST *ast) {
+    if (!ast) return ast;
+    switch (ast->type) {
+        case AST_BINOP:
+            ast->bin.left = fold_expr(ast->bin.left);
+            ast->bin.right = fold_expr(ast->bin.right);
+            // Mesma semantica da execucao: o resultado vem de value_binop.
+            if (is_literal(ast->bin.left) && is_literal(ast->bin.right))
+                return make_literal(value_binop(ast->op, literal_value(ast->bin.left),
+                                                literal_value(ast->bin.right)));
+            if (ast->op == OP_ADD && ast->vtype == TYPE_STRING)
+                return flatten_concat(ast);
+            return ast;
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+            for (int i = 0; i < ast->list.count; i++)
+                ast->list.items[i] = fold_expr(ast->list.items[i]);
+            return ast;
+        case AST_AWAIT:
+            ast->stmt.expr = fold_expr(ast->stmt.expr);
+            return ast;
+        default:
+            return ast;
+    }
+}
+
+// Operando que pode ser avaliado depois de anexar a `sym`: nao le a variavel
+// nem chama funcoes (que poderiam ler ou trocar uma global).
+static int append_safe(AST *ast, int sym) {
+    switch (ast->type) {
+        case AST_LITERAL: return 1;
+        case AST_IDENTIFIER: return ast->sym != sym;
+        case AST_BINOP: return append_safe(ast->bin.left, sym) && append_safe(ast->bin.right, sym);
+        case AST_CONCAT:
+            for (int i = 0; i < ast->list.count; i++)
+                if (!append_safe(ast->list.items[i], sym)) return 0;
+            return 1;
+        default: return 0;
+    }
+}
+
+// `x = x + a + b ...` com x string: a concatenacao comeca por x.
+static int is_self_append(AST *assign) {
+    AST *e = assign->stmt.expr;
+    if (e->type != AST_CONCAT) return 0;
+    AST *first = e->list.items[0];
+    if (first->type != AST_IDENTIFIER || first->sym != assign->sym || first->vtype != TYPE_STRING) return 0;
+    for (int i = 1; i < e->list.count; i++)
+        if (!append_safe(e->list.items[i], assign->sym)) return 0;
+    return 1;
+}
+
+// Otimiza os filhos de um bloco, retirando os que viraram NULL.
+static void optimize_block(AST *block) {
+    int n = 0;
+    for (int i = 0; i < block->list.count; i++) {
+        AST *stmt = optimize_stmt(block->list.items[i]);
+        if (stmt) block->list.items[n++] = stmt;
+    }
+    block->list.count = n;
+}
+
+// Declaracoes de um ramo que vai ser removido, inclusive em if/while
+// aninhados (que tambem nao abrem escopo), viram DECL_ONLY em `out`.
+static void keep_decls(AST *ast, AST ***out, int *count, int *cap) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                keep_decls(ast->list.items[i], out, count, cap);
+            break;
+        case AST_VAR_DECL: {
+            AST *decl = ast_new(AST_VAR_DECL);
+            decl->op = DECL_ONLY;
+            decl->sym = ast->sym;
+            decl->vtype = ast->vtype;
+            decl->line = ast->line;
+            decl->col = ast->col;
+            decl->stmt.type_sym = ast->stmt.type_sym;
+            if (*count == *cap) {
+                *cap = *cap ? *cap * 2 : 8;
+                *out = realloc(*out, sizeof(AST*) * *cap);
+            }
+            (*out)[(*count)++] = decl;
+            break;
+        }
+        case AST_IF:
+            keep_decls(ast->branch.then_body, out, count, cap);
+            keep_decls(ast->branch.else_body, out, count, cap);
+            break;
+        case AST_WHILE:
+            keep_decls(ast->loop.body, out, count, cap);
+            break;
+        default:
+            break;
+    }
+}
+
+// `kept` no lugar de um if/while: o ramo que roda (ou nada), precedido
+// pelas declaracoes do que foi removido.
+static AST *prune(AST *kept, AST *removed) {
+    AST **decls = NULL;
+    int count = 0, cap = 0;
+    keep_decls(removed, &decls, &count, &cap);
+    if (count == 0) return kept;
+    if (kept) {
+        decls = realloc(decls, sizeof(AST*) * (count + 1));
+        decls[count++] = kept;
+    }
+    AST *block = ast_new_list(AST_PROGRAM, decls, count);
+    free(decls);
+    return block;
+}
+
+// Devolve o comando otimizado, ou NULL quando ele pode ser removido.
+static AST* optimize_stmt(AST *ast) {
+    if (!ast) return ast;
+    switch (ast->type) {
+        case AST_PROGRAM:
+            optimize_block(ast);
+            return ast;
+        case AST_ASSIGN:
+            ast->stmt.expr = fold_expr(ast->stmt.expr);
+            if (is_self_append(ast)) ast->op = ASSIGN_APPEND;
+            return ast;
+        case AST_VAR_DECL:
+        case AST_PRINT:
+        case AST_RETURN:
+            ast->stmt.expr = fold_expr(ast->stmt.expr);
+            return ast;
+        case AST_FUNC_CALL:
+            return fold_expr(ast);
+        case AST_FUNC_DECL:
+            optimize_block(ast->func.body);
+            return ast;
+        case AST_IF:
+            ast->branch.cond = fold_expr(ast->branch.cond);
+            optimize_block(ast->branch.then_body);
+            if (ast->branch.else_body) optimize_block(ast->branch.else_body);
+            // Blocos nao abrem escopo: o ramo escolhido toma o lugar do if e
+            // as declaracoes do outro ficam como DECL_ONLY, entao a
+            // visibilidade das variaveis e a mesma com ou sem otimizacao.
+            if (is_literal(ast->branch.cond)) {
+                if (literal_truth(ast->branch.cond)) return prune(ast->branch.then_body, ast->branch.else_body);
+                return prune(ast->branch.else_body, ast->branch.then_body);
+            }
+            return ast;
+        case AST_WHILE:
+            ast->loop.cond = fold_expr(ast->loop.cond);
+            if (is_literal(ast->loop.cond) && !literal_truth(ast->loop.cond))
+                return prune(NULL, ast->loop.body);
+            optimize_block(ast->loop.body);
+            return ast;
+        case AST_FOR:
+            optimize_stmt(ast->loop.init);
+            ast->loop.cond = fold_expr(ast->loop.cond);
+            optimize_stmt(ast->loop.incr);
+            optimize_block(ast->loop.body);
+            return ast;
+        case AST_PARALLEL_FOR:
+            optimize_stmt(ast->par.loop);
+            return ast;
+        default:
+            return ast;
+    }
+}
+
+AST* optimize(AST *program) {
+    if (program) optimize_block(program);
+    return program;
+}
@@ -0,0 +1,9 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+#include "parser.h"
+
+// Passe de otimizacao entre parse_program() e a execucao: dobra
+// subexpressoes constantes em literais e remove ramos mortos.
+AST* optimize(AST *program);
+
+#endif
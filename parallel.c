@@ -0,0 +1,398 @@
+#include "parallel.h"
+#include "errors.h"
+#include "symtab.h"
+#include <stdarg.h>
+#include <stdlib.h>
+
+static _Thread_local AST **decls;           // index -> AST_FUNC_DECL
+static _Thread_local unsigned char *safe;   // index -> chamavel de um parallel for
+static _Thread_local unsigned char *isolated; // index -> segura e sem globais: vale para spawn
+static _Thread_local int decl_count;
+
+// Variaveis declaradas no corpo do laco em verificacao (slots locais).
+static _Thread_local int *body_slots;
+static _Thread_local int body_count, body_cap;
+static _Thread_local AST *reduce;           // IDENTIFIER de reduce sum, ou NULL
+
+static void report(const char *what, const char *fmt, va_list ap) {
+    error_printf("%s: ", what);
+    error_vprintf(fmt, ap);
+    error_printf("\n");
+    error_exit();
+}
+
+static void parallel_error(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    report("Parallel for", fmt, ap);
+}
+
+static void spawn_error(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    report("Spawn", fmt, ap);
+}
+
+static int is_string(AST *ast) {
+    return ast->vtype == TYPE_STRING || ast->type == AST_CONCAT;
+}
+
+// Corpo de funcao seguro: sem strings, print, input nem escrita em globais,
+// sem ler handles globais e chamando so funcoes marcadas em `marks`. Com
+// `globals` 0 nenhuma global pode ser lida.
+static int func_safe(AST *ast, const unsigned char *marks, int globals) {
+    if (!ast) return 1;
+    if (ast->type != AST_PROGRAM && is_string(ast)) return 0;
+    switch (ast->type) {
+        case AST_PRINT:
+        case AST_INPUT:
+            return 0;
+        case AST_IDENTIFIER:
+            return ast->depth != SLOT_GLOBAL || (globals && ast->vtype != TYPE_TASK);
+        case AST_ASSIGN:
+            if (ast->depth == SLOT_GLOBAL) return 0;
+            /* fallthrough */
+        case AST_VAR_DECL:
+        case AST_RETURN:
+        case AST_AWAIT:
+            return func_safe(ast->stmt.expr, marks, globals);
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+            if (!marks[ast->list.index]) return 0;
+            /* fallthrough */
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                if (!func_safe(ast->list.items[i], marks, globals)) return 0;
+            return 1;
+        case AST_BINOP:
+            return func_safe(ast->bin.left, marks, globals) && func_safe(ast->bin.right, marks, globals);
+        case AST_IF:
+            return func_safe(ast->branch.cond, marks, globals) && func_safe(ast->branch.then_body, marks, globals) &&
+                   func_safe(ast->branch.else_body, marks, globals);
+        case AST_WHILE:
+        case AST_FOR:
+            return func_safe(ast->loop.init, marks, globals) && func_safe(ast->loop.cond, marks, globals) &&
+                   func_safe(ast->loop.incr, marks, globals) && func_safe(ast->loop.body, marks, globals);
+        case AST_PARALLEL_FOR:
+            return func_safe(ast->par.loop, marks, globals);
+        default:
+            return 1;
+    }
+}
+
+// Parte de todas marcadas e desmarca ate estabilizar (recursao continua
+// marcada).
+static unsigned char *mark_funcs(int globals) {
+    unsigned char *marks = malloc(decl_count + 1);
+    for (int i = 0; i < decl_count; i++) {
+        AST *d = decls[i];
+        marks[i] = d->func.type_sym != SYM_STRING;
+        for (int p = 0; p < d->func.params_count; p++)
+            if (d->func.params[p].type == SYM_STRING) marks[i] = 0;
+    }
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < decl_count; i++)
+            if (marks[i] && !func_safe(decls[i]->func.body, marks, globals)) {
+                marks[i] = 0;
+                changed = 1;
+            }
+    }
+    return marks;
+}
+
+static void find_safe(AST *program) {
+    decls = malloc(sizeof(AST*) * (program->list.count + 1));
+    decl_count = 0;
+    for (int i = 0; i < program->list.count; i++)
+        if (program->list.items[i]->type == AST_FUNC_DECL) decls[decl_count++] = program->list.items[i];
+    safe = mark_funcs(1);
+    isolated = mark_funcs(0);
+}
+
+static void collect_body_slots(AST *ast) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_VAR_DECL:
+            if (body_count == body_cap) {
+                body_cap = body_cap ? body_cap * 2 : 16;
+                body_slots = realloc(body_slots, sizeof(int) * body_cap);
+            }
+            body_slots[body_count++] = ast->stmt.slot;
+            break;
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++) collect_body_slots(ast->list.items[i]);
+            break;
+        case AST_IF:
+            collect_body_slots(ast->branch.then_body);
+            collect_body_slots(ast->branch.else_body);
+            break;
+        case AST_WHILE:
+        case AST_FOR:
+            collect_body_slots(ast->loop.init);
+            collect_body_slots(ast->loop.body);
+            break;
+        case AST_PARALLEL_FOR:
+            collect_body_slots(ast->par.loop);
+            break;
+        default:
+            break;
+    }
+}
+
+static int in_body(AST *var, int slot) {
+    if (var->depth != SLOT_LOCAL) return 0;
+    for (int i = 0; i < body_count; i++)
+        if (body_slots[i] == slot) return 1;
+    return 0;
+}
+
+static int same_var(AST *a, int a_slot, AST *b, int b_slot) {
+    return a->depth == b->depth && a_slot == b_slot;
+}
+
+static int reads(AST *ast, AST *var) {
+    if (!ast) return 0;
+    switch (ast->type) {
+        case AST_IDENTIFIER:
+            return same_var(ast, ast->var.slot, var, var->var.slot);
+        case AST_BINOP:
+            return reads(ast->bin.left, var) || reads(ast->bin.right, var);
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+        case AST_CONCAT:
+            for (int i = 0; i < ast->list.count; i++)
+                if (reads(ast->list.items[i], var)) return 1;
+            return 0;
+        case AST_AWAIT:
+            return reads(ast->stmt.expr, var);
+        default:
+            return 0;
+    }
+}
+
+static int has_call(AST *ast) {
+    if (!ast) return 0;
+    switch (ast->type) {
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+        case AST_AWAIT:
+            return 1;
+        case AST_BINOP:
+            return has_call(ast->bin.left) || has_call(ast->bin.right);
+        case AST_CONCAT:
+            for (int i = 0; i < ast->list.count; i++)
+                if (has_call(ast->list.items[i])) return 1;
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static void check_body(AST *ast);
+
+// `r + a + b ...` (associado a esquerda) com r a variavel de reduce e os
+// demais termos sem le-la.
+static int check_sum(AST *e) {
+    if (e->type == AST_IDENTIFIER) return same_var(e, e->var.slot, reduce, reduce->var.slot);
+    if (e->type != AST_BINOP || e->op != OP_ADD || reads(e->bin.right, reduce)) return 0;
+    check_body(e->bin.right);
+    return check_sum(e->bin.left);
+}
+
+static void check_body(AST *ast) {
+    if (!ast) return;
+    if (ast->type != AST_PROGRAM && ast->type != AST_PARALLEL_FOR && is_string(ast))
+        parallel_error("strings are not allowed in the loop body");
+    switch (ast->type) {
+        case AST_PRINT:
+            parallel_error("print is not allowed in the loop body");
+            break;
+        case AST_INPUT:
+            parallel_error("input is not allowed in the loop body");
+            break;
+        case AST_RETURN:
+            parallel_error("return is not allowed in the loop body");
+            break;
+        case AST_IDENTIFIER:
+            if (reduce && same_var(ast, ast->var.slot, reduce, reduce->var.slot))
+                parallel_error("%s can only be used as %s = %s + ...", sym_name(ast->sym), sym_name(ast->sym), sym_name(ast->sym));
+            // Esperar uma tarefa de fora poderia travar: ela pode estar
+            // suspensa mais abaixo na pilha da mesma thread.
+            if (ast->vtype == TYPE_TASK && !in_body(ast, ast->var.slot))
+                parallel_error("cannot use task %s, declared outside the loop", sym_name(ast->sym));
+            break;
+        case AST_ASSIGN:
+            if (in_body(ast, ast->stmt.slot)) {
+                check_body(ast->stmt.expr);
+            } else if (reduce && same_var(ast, ast->stmt.slot, reduce, reduce->var.slot)) {
+                if (!check_sum(ast->stmt.expr))
+                    parallel_error("%s can only be used as %s = %s + ...", sym_name(ast->sym), sym_name(ast->sym), sym_name(ast->sym));
+            } else {
+                parallel_error("cannot assign to %s, declared outside the loop (use reduce sum)", sym_name(ast->sym));
+            }
+            break;
+        case AST_VAR_DECL:
+        case AST_AWAIT:
+            check_body(ast->stmt.expr);
+            break;
+        case AST_FUNC_CALL:
+        case AST_SPAWN:
+            if (!safe[ast->list.index])
+                parallel_error("cannot call %s (it uses strings, print or input, or writes globals)", sym_name(ast->sym));
+            /* fallthrough */
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++) check_body(ast->list.items[i]);
+            break;
+        case AST_BINOP:
+            check_body(ast->bin.left);
+            check_body(ast->bin.right);
+            break;
+        case AST_IF:
+            check_body(ast->branch.cond);
+            check_body(ast->branch.then_body);
+            check_body(ast->branch.else_body);
+            break;
+        case AST_WHILE:
+        case AST_FOR:
+            check_body(ast->loop.init);
+            check_body(ast->loop.cond);
+            check_body(ast->loop.incr);
+            check_body(ast->loop.body);
+            break;
+        case AST_PARALLEL_FOR:
+            check_body(ast->par.loop);
+            break;
+        default:
+            break;
+    }
+}
+
+static void check_loop(AST *par) {
+    AST *loop = par->par.loop, *incr = loop->loop.incr, *cond = loop->loop.cond;
+    if (incr->type != AST_ASSIGN || incr->depth != SLOT_LOCAL || incr->vtype != TYPE_INT || incr->op == ASSIGN_APPEND)
+        parallel_error("the increment must be i = i + constant on a local int");
+    int slot = incr->stmt.slot;
+    AST *step = incr->stmt.expr;
+    if (step->type != AST_BINOP || (step->op != OP_ADD && step->op != OP_SUB) ||
+        step->bin.left->type != AST_IDENTIFIER || step->bin.left->depth != SLOT_LOCAL || step->bin.left->var.slot != slot ||
+        step->bin.right->type != AST_LITERAL || step->bin.right->lit.int_value == 0)
+        parallel_error("the increment must be %s = %s + constant", sym_name(incr->sym), sym_name(incr->sym));
+    int up = (step->op == OP_ADD) == (step->bin.right->lit.int_value > 0);
+    if (cond->type != AST_BINOP || cond->bin.left->type != AST_IDENTIFIER ||
+        cond->bin.left->depth != SLOT_LOCAL || cond->bin.left->var.slot != slot)
+        parallel_error("the condition must compare %s with a limit", sym_name(incr->sym));
+    if (up ? cond->op != OP_LT && cond->op != OP_LTE : cond->op != OP_GT && cond->op != OP_GTE)
+        parallel_error("the condition must be %s %s limit", sym_name(incr->sym), up ? "< or <=" : "> or >=");
+    if (has_call(cond->bin.right) || reads(cond->bin.right, cond->bin.left))
+        parallel_error("the limit cannot call functions or depend on %s", sym_name(incr->sym));
+
+    reduce = par->par.reduce;
+    if (reduce && reduce->depth == SLOT_LOCAL && reduce->var.slot == slot)
+        parallel_error("cannot reduce into the loop variable %s", sym_name(reduce->sym));
+    if (reduce && reads(cond->bin.right, reduce))
+        parallel_error("the limit cannot depend on %s", sym_name(reduce->sym));
+    body_count = 0;
+    collect_body_slots(loop->loop.body);
+    check_body(loop->loop.body);
+    reduce = NULL;
+}
+
+// Acha os parallel for (inclusive aninhados) e verifica cada um.
+static void walk(AST *ast) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++) walk(ast->list.items[i]);
+            break;
+        case AST_FUNC_DECL:
+            walk(ast->func.body);
+            break;
+        case AST_IF:
+            walk(ast->branch.then_body);
+            walk(ast->branch.else_body);
+            break;
+        case AST_WHILE:
+        case AST_FOR:
+            walk(ast->loop.body);
+            break;
+        case AST_PARALLEL_FOR:
+            check_loop(ast);
+            walk(ast->par.loop->loop.body);
+            break;
+        default:
+            break;
+    }
+}
+
+// Verifica cada spawn do programa, em qualquer comando ou expressao.
+static void check_spawns(AST *ast) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_SPAWN: {
+            AST *d = decls[ast->list.index];
+            if (!isolated[ast->list.index])
+                spawn_error("cannot spawn %s (it uses strings, print or input, or globals)", sym_name(ast->sym));
+            for (int p = 0; p < d->func.params_count; p++)
+                if (d->func.params[p].type == SYM_TASK)
+                    spawn_error("cannot spawn %s (it takes a task parameter)", sym_name(ast->sym));
+        }
+            /* fallthrough */
+        case AST_PROGRAM:
+        case AST_FUNC_CALL:
+        case AST_CONCAT:
+            for (int i = 0; i < ast->list.count; i++) check_spawns(ast->list.items[i]);
+            break;
+        case AST_FUNC_DECL:
+            check_spawns(ast->func.body);
+            break;
+        case AST_VAR_DECL:
+        case AST_ASSIGN:
+        case AST_PRINT:
+        case AST_RETURN:
+        case AST_AWAIT:
+            check_spawns(ast->stmt.expr);
+            break;
+        case AST_BINOP:
+            check_spawns(ast->bin.left);
+            check_spawns(ast->bin.right);
+            break;
+        case AST_IF:
+            check_spawns(ast->branch.cond);
+            check_spawns(ast->branch.then_body);
+            check_spawns(ast->branch.else_body);
+            break;
+        case AST_WHILE:
+        case AST_FOR:
+            check_spawns(ast->loop.init);
+            check_spawns(ast->loop.cond);
+            check_spawns(ast->loop.incr);
+            check_spawns(ast->loop.body);
+            break;
+        case AST_PARALLEL_FOR:
+            check_spawns(ast->par.loop);
+            break;
+        default:
+            break;
+    }
+}
+
+void check_parallel(AST *program) {
+    // Um erro numa carga de MacsContext volta ao setjmp sem passar pelo fim.
+    free(decls);
+    free(safe);
+    free(isolated);
+    find_safe(program);
+    check_spawns(program);
+    walk(program);
+    free(decls);
+    free(safe);
+    free(isolated);
+    free(body_slots);
+    decls = NULL;
+    safe = NULL;
+    isolated = NULL;
+    body_slots = NULL;
+    body_count = body_cap = 0;
+}
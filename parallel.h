@@ -0,0 +1,22 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include "parser.h"
+
+// Regras do `parallel for` e do spawn, verificadas depois do resolve (usa os
+// slots):
+//  - a forma e a de um laco contado: `i = i + c` ou `i - c` com c literal,
+//    condicao `i < limite` (<=, ou > e >= se c < 0) e limite sem chamadas,
+//    sem ler i nem a variavel de reduce; o limite e avaliado uma vez;
+//  - o corpo so usa int, bool e tasks declarados nele, nao faz print, input
+//    nem return, e so escreve variaveis declaradas nele; a variavel de
+//    `reduce sum r` so aparece como `r = r + expr`, com expr sem ler r;
+//  - as funcoes chamadas (e as que elas chamam) so usam int, bool e task,
+//    nao fazem print nem input e nao escrevem globais;
+//  - uma funcao disparada com spawn segue as mesmas regras, nao le globais
+//    e nao recebe tasks; tudo o que ela espera foi criado por ela.
+// Com isso as voltas e as tarefas sao independentes: executa-las em qualquer
+// ordem, em qualquer numero de threads ou em sequencia da o mesmo resultado,
+// e a soma de inteiros (modulo 2^32) e a mesma em qualquer agrupamento.
+void check_parallel(AST *program);
+
+#endif
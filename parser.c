@@ -1,174 +1,282 @@
 #include "parser.h"
+#include "errors.h"
 #include "lexer.h"
+#include "symtab.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
-static Token current_token;
+static _Thread_local Token current_token;
+static _Thread_local Arena arena;
+
+// Pilha de rascunho onde os filhos de blocos e chamadas sao acumulados ate o
+// fim da lista; entao sao copiados de uma vez para a arena, logo apos o no.
+static _Thread_local AST **scratch = NULL;
+static _Thread_local int scratch_top = 0, scratch_cap = 0;
+
+#define VARIANT_SIZE(member) (offsetof(AST, member) + sizeof(((AST*)0)->member))
+
+size_t ast_size(ASTType type) {
+    switch (type) {
+        case AST_LITERAL: return VARIANT_SIZE(lit);
+        case AST_BINOP: return VARIANT_SIZE(bin);
+        case AST_VAR_DECL: case AST_ASSIGN: case AST_PRINT: case AST_RETURN: case AST_AWAIT: return VARIANT_SIZE(stmt);
+        case AST_PROGRAM: case AST_FUNC_CALL: case AST_SPAWN: case AST_CONCAT: return VARIANT_SIZE(list);
+        case AST_IF: return VARIANT_SIZE(branch);
+        case AST_WHILE: case AST_FOR: return VARIANT_SIZE(loop);
+        case AST_PARALLEL_FOR: return VARIANT_SIZE(par);
+        case AST_FUNC_DECL: return VARIANT_SIZE(func);
+        default: return VARIANT_SIZE(var); // AST_IDENTIFIER, AST_INPUT
+    }
+}
 
 static AST* make_ast(ASTType type) {
-    AST* ast = calloc(1, sizeof(AST));
+    AST* ast = arena_alloc(&arena, ast_size(type));
+    ast->type = type;
+    ast->line = current_token.line;
+    ast->col = current_token.col;
+    return ast;
+}
+
+static void scratch_push(AST *ast) {
+    if (scratch_top == scratch_cap) {
+        scratch_cap = scratch_cap ? scratch_cap * 2 : 64;
+        scratch = realloc(scratch, sizeof(AST*) * scratch_cap);
+    }
+    scratch[scratch_top++] = ast;
+}
+
+// Cria um no de lista com os filhos empilhados desde `mark`.
+static AST* make_list(ASTType type, int mark) {
+    int count = scratch_top - mark;
+    AST* ast = arena_alloc(&arena, ast_size(type) + sizeof(AST*) * count);
     ast->type = type;
+    ast->line = current_token.line;
+    ast->col = current_token.col;
+    ast->list.count = count;
+    ast->list.items = (AST**)((char*)ast + ast_size(type));
+    memcpy(ast->list.items, scratch + mark, sizeof(AST*) * count);
+    scratch_top = mark;
     return ast;
 }
 
 static AST* parse_statement();
+static AST* parse_statement_kind();
 static AST* parse_block();
 static AST* parse_expr();
 static AST* parse_primary();
 static AST* parse_assignment();
 static AST* parse_assignment_inline();
+static AST* parse_call(int sym);
 
 static void next() { current_token = get_next_token(); }
 static int accept(TokenType t) { if (current_token.type == t) { next(); return 1; } return 0; }
-static void expect(TokenType t) { if (!accept(t)) { printf("Syntax error: expected %d\n", t); exit(1); } }
+static void expect(TokenType t) { if (!accept(t)) { error_printf("Syntax error: expected %d\n", t); error_exit(); } }
 
+// Usado pelos passes de otimizacao para criar nos na mesma arena.
+AST* ast_new(ASTType type) {
+    AST *ast = make_ast(type);
+    ast->line = ast->col = 0;
+    return ast;
+}
+
+AST* ast_new_list(ASTType type, AST **items, int count) {
+    int mark = scratch_top;
+    for (int i = 0; i < count; i++) scratch_push(items[i]);
+    AST *ast = make_list(type, mark);
+    ast->line = ast->col = 0;
+    return ast;
+}
+
+// Literais de string sao Str estaticas na arena: avalia-los nao copia nada.
+Str* ast_str(const char *s, int len) {
+    Str *str = arena_alloc(&arena, sizeof(Str));
+    str->refs = STR_STATIC;
+    str->len = str->cap = len;
+    str->chars = arena_strndup(&arena, s, len);
+    return str;
+}
+
+// Toda a arvore vive na arena: liberar e uma unica operacao.
 void free_ast(AST *ast) {
-    if (!ast) return;
-    if (ast->left) free_ast(ast->left);
-    if (ast->right) free_ast(ast->right);
-    if (ast->cond) free_ast(ast->cond);
-    if (ast->then_body) free_ast(ast->then_body);
-    if (ast->else_body) free_ast(ast->else_body);
-    if (ast->body) free_ast(ast->body);
-    if (ast->init) free_ast(ast->init);
-    if (ast->incr) free_ast(ast->incr);
-    if (ast->block) free_ast(ast->block);
-    if (ast->params_list) free_ast(ast->params_list);
-    if (ast->children) {
-        for (int i = 0; i < ast->children_count; i++)
-            free_ast(ast->children[i]);
-        free(ast->children);
-    }
-    if (ast->left_return) free_ast(ast->left_return);
-    free(ast);
+    (void)ast;
+    arena_release(&arena);
+    free(scratch);
+    scratch = NULL;
+    scratch_top = scratch_cap = 0;
+}
+
+// Entrega a arvore a quem vai mante-la (um MacsContext); a arena da thread
+// fica vazia para o proximo parse.
+void ast_take_arena(Arena *out) {
+    *out = arena;
+    memset(&arena, 0, sizeof(arena));
+    free(scratch);
+    scratch = NULL;
+    scratch_top = scratch_cap = 0;
+}
+
+size_t ast_memory_used(void) {
+    return arena.reserved;
 }
 
 static AST* parse_program_node() {
-    AST* prog = make_ast(AST_PROGRAM);
-    prog->children = NULL;
-    prog->children_count = 0;
-    while (current_token.type != TOK_EOF) {
-        AST* stmt = parse_statement();
-        prog->children = realloc(prog->children, sizeof(AST*) * (prog->children_count + 1));
-        prog->children[prog->children_count++] = stmt;
-    }
-    return prog;
+    int mark = scratch_top;
+    while (current_token.type != TOK_EOF)
+        scratch_push(parse_statement());
+    return make_list(AST_PROGRAM, mark);
 }
 
 static AST* parse_func_decl() {
     expect(TOK_FUNC);
     AST* ast = make_ast(AST_FUNC_DECL);
-    if (current_token.type != TOK_IDENTIFIER) { printf("Expected function name\n"); exit(1); }
-    strcpy(ast->name, current_token.text);
+    if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected function name\n"); error_exit(); }
+    ast->sym = current_token.sym;
     next();
     expect(TOK_LPAREN);
-    int pcount = 0;
+    int pcount = 0, pcap = 0;
+    Param *params = NULL;
     if (current_token.type != TOK_RPAREN) {
         do {
-            if (current_token.type != TOK_IDENTIFIER) { printf("Expected parameter name\n"); exit(1); }
-            strcpy(ast->params[pcount].name, current_token.text);
+            if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected parameter name\n"); error_exit(); }
+            if (pcount == pcap) {
+                pcap = pcap ? pcap * 2 : 8;
+                params = realloc(params, sizeof(Param) * pcap);
+            }
+            params[pcount].name = current_token.sym;
             next();
             expect(TOK_COLON);
-            if (current_token.type != TOK_IDENTIFIER) { printf("Expected parameter type\n"); exit(1); }
-            strcpy(ast->params[pcount].type, current_token.text);
+            if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected parameter type\n"); error_exit(); }
+            params[pcount].type = current_token.sym;
             next();
             pcount++;
         } while (accept(TOK_COMMA));
     }
     expect(TOK_RPAREN);
     expect(TOK_COLON);
-    if (current_token.type != TOK_IDENTIFIER) { printf("Expected return type\n"); exit(1); }
-    strcpy(ast->str_value, current_token.text); // tipo de retorno
+    if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected return type\n"); error_exit(); }
+    ast->func.type_sym = current_token.sym; // tipo de retorno
     next();
-    ast->params_count = pcount;
-    ast->body = parse_block();
+    ast->func.params_count = pcount;
+    ast->func.params = arena_alloc(&arena, sizeof(Param) * pcount);
+    if (pcount) memcpy(ast->func.params, params, sizeof(Param) * pcount);
+    free(params);
+    ast->func.body = parse_block();
     return ast;
 }
 
 static AST* parse_block() {
     expect(TOK_LBRACE);
-    AST* block = make_ast(AST_PROGRAM);
-    block->children = NULL;
-    block->children_count = 0;
-    while (current_token.type != TOK_RBRACE) {
-        AST* stmt = parse_statement();
-        block->children = realloc(block->children, sizeof(AST*) * (block->children_count + 1));
-        block->children[block->children_count++] = stmt;
-    }
+    int mark = scratch_top;
+    while (current_token.type != TOK_RBRACE)
+        scratch_push(parse_statement());
     expect(TOK_RBRACE);
-    return block;
+    return make_list(AST_PROGRAM, mark);
 }
 
 
+static AST* parse_var_decl();
+
+// Depois de `for`; em `parallel for`, le tambem o `reduce sum x` opcional
+// entre os parenteses e o corpo.
+static AST* parse_for(AST *parallel) {
+    AST* ast = make_ast(AST_FOR);
+    expect(TOK_LPAREN);
+    if (current_token.type == TOK_VAR) {
+        ast->loop.init = parse_var_decl();
+    } else if (current_token.type == TOK_IDENTIFIER) {
+        ast->loop.init = parse_assignment_inline();
+        expect(TOK_SEMI);
+    } else {
+        error_printf("Syntax error in for-init\n");
+        error_exit();
+    }
+
+    ast->loop.cond = parse_expr();
+    expect(TOK_SEMI);
+
+    ast->loop.incr = parse_assignment_inline();
+    expect(TOK_RPAREN);
+
+    if (parallel && accept(TOK_REDUCE)) {
+        if (current_token.type != TOK_IDENTIFIER || current_token.sym != sym_intern("sum", 3)) {
+            error_printf("Syntax error: expected sum after reduce\n");
+            error_exit();
+        }
+        next();
+        if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected variable name after reduce sum\n"); error_exit(); }
+        AST *var = make_ast(AST_IDENTIFIER);
+        var->sym = current_token.sym;
+        next();
+        parallel->par.reduce = var;
+    }
+
+    ast->loop.body = parse_block();
+    return ast;
+}
+
 static AST* parse_var_decl() {
     expect(TOK_VAR);
     AST* ast = make_ast(AST_VAR_DECL);
-    if (current_token.type != TOK_IDENTIFIER) { printf("Expected variable name\n"); exit(1); }
-    strcpy(ast->name, current_token.text);
+    if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected variable name\n"); error_exit(); }
+    ast->sym = current_token.sym;
     next();
     expect(TOK_COLON);
-    if (current_token.type != TOK_IDENTIFIER) { printf("Expected type\n"); exit(1); }
-    if (
-        strcmp(current_token.text, "int") == 0 ||
-        strcmp(current_token.text, "string") == 0 ||
-        strcmp(current_token.text, "bool") == 0
-    ) {
-        strcpy(ast->str_value, current_token.text);
+    if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected type\n"); error_exit(); }
+    if (current_token.sym == SYM_INT || current_token.sym == SYM_STRING || current_token.sym == SYM_BOOL || current_token.sym == SYM_TASK) {
+        ast->stmt.type_sym = current_token.sym;
     } else {
-        printf("Unknown type: %s\n", current_token.text);
-        exit(1);
+        error_printf("Unknown type: %s\n", sym_name(current_token.sym));
+        error_exit();
     }
     next();
     if (accept(TOK_ASSIGN)) {
-        ast->left = parse_expr();
+        ast->stmt.expr = parse_expr();
     }
     expect(TOK_SEMI);
     return ast;
 }
 
+// Comando com a posicao do seu primeiro token: make_ast marca o token
+// corrente, que em `x = ...` ja e o `=`.
 static AST* parse_statement() {
+    int line = current_token.line, col = current_token.col;
+    AST *ast = parse_statement_kind();
+    ast->line = line;
+    ast->col = col;
+    return ast;
+}
+
+static AST* parse_statement_kind() {
     if (current_token.type == TOK_VAR)
         return parse_var_decl();
     if (current_token.type == TOK_FUNC)
         return parse_func_decl();
     if (current_token.type == TOK_IDENTIFIER) {
-        char tmpname[64];
-        strcpy(tmpname, current_token.text);
+        int tmpsym = current_token.sym;
         next();
         if (current_token.type == TOK_ASSIGN) {
             AST* ast = make_ast(AST_ASSIGN);
-            strcpy(ast->name, tmpname);
+            ast->sym = tmpsym;
             expect(TOK_ASSIGN);
-            ast->left = parse_expr();
+            ast->stmt.expr = parse_expr();
             expect(TOK_SEMI);
             return ast;
         } else if (current_token.type == TOK_LPAREN) {
-            AST* ast = make_ast(AST_FUNC_CALL);
-            strcpy(ast->name, tmpname);
-            next();
-            ast->children = NULL;
-            ast->children_count = 0;
-            if (current_token.type != TOK_RPAREN) {
-                do {
-                    AST* arg = parse_expr();
-                    ast->children = realloc(ast->children, sizeof(AST*) * (ast->children_count + 1));
-                    ast->children[ast->children_count++] = arg;
-                } while (accept(TOK_COMMA));
-            }
-            expect(TOK_RPAREN);
+            AST* ast = parse_call(tmpsym);
             expect(TOK_SEMI);
             return ast;
         } else {
-            printf("Syntax error after identifier\n");
-            exit(1);
+            error_printf("Syntax error after identifier\n");
+            error_exit();
         }
     }
     if (current_token.type == TOK_PRINT) {
         AST* ast = make_ast(AST_PRINT);
         next();
         expect(TOK_LPAREN);
-        ast->left = parse_expr();
+        ast->stmt.expr = parse_expr();
         expect(TOK_RPAREN);
         expect(TOK_SEMI);
         return ast;
@@ -177,8 +285,8 @@ static AST* parse_statement() {
         AST* ast = make_ast(AST_INPUT);
         next();
         expect(TOK_LPAREN);
-        if (current_token.type != TOK_IDENTIFIER) { printf("Expected variable name for input\n"); exit(1); }
-        strcpy(ast->name, current_token.text);
+        if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected variable name for input\n"); error_exit(); }
+        ast->sym = current_token.sym;
         next();
         expect(TOK_RPAREN);
         expect(TOK_SEMI);
@@ -188,11 +296,11 @@ static AST* parse_statement() {
         AST* ast = make_ast(AST_IF);
         next();
         expect(TOK_LPAREN);
-        ast->cond = parse_expr();
+        ast->branch.cond = parse_expr();
         expect(TOK_RPAREN);
-        ast->then_body = parse_block();
+        ast->branch.then_body = parse_block();
         if (accept(TOK_ELSE)) {
-            ast->else_body = parse_block();
+            ast->branch.else_body = parse_block();
         }
         return ast;
     }
@@ -200,86 +308,69 @@ static AST* parse_statement() {
         AST* ast = make_ast(AST_WHILE);
         next();
         expect(TOK_LPAREN);
-        ast->cond = parse_expr();
+        ast->loop.cond = parse_expr();
         expect(TOK_RPAREN);
-        ast->body = parse_block();
+        ast->loop.body = parse_block();
         return ast;
     }
     if (current_token.type == TOK_FOR) {
-        AST* ast = make_ast(AST_FOR);
         next();
-        expect(TOK_LPAREN);
-        if (current_token.type == TOK_VAR) {
-            ast->init = parse_var_decl();
-        } else if (current_token.type == TOK_IDENTIFIER) {
-            ast->init = parse_assignment_inline();
-            expect(TOK_SEMI);
-        } else {
-            printf("Syntax error in for-init\n");
-            exit(1);
-        }
-
-        ast->cond = parse_expr();
-        expect(TOK_SEMI);
-
-        ast->incr = parse_assignment_inline();
-        expect(TOK_RPAREN);
-
-        ast->body = parse_block();
+        return parse_for(NULL);
+    }
+    // parallel for (...) [reduce sum total] { ... }: `sum` nao e palavra
+    // reservada, so tem sentido logo depois de `reduce`.
+    if (current_token.type == TOK_PARALLEL) {
+        AST* ast = make_ast(AST_PARALLEL_FOR);
+        next();
+        expect(TOK_FOR);
+        ast->par.loop = parse_for(ast);
         return ast;
     }
     if (current_token.type == TOK_RETURN) {
         AST* ast = make_ast(AST_RETURN);
         next();
-        ast->left = parse_expr();
+        ast->stmt.expr = parse_expr();
         expect(TOK_SEMI);
         return ast;
     }
-    printf("Syntax error: unknown statement\n");
-    exit(1);
+    error_printf("Syntax error: unknown statement\n");
+    error_exit();
 }
 
 static AST* parse_primary() {
     if (current_token.type == TOK_INT) {
         AST* ast = make_ast(AST_LITERAL);
-        ast->int_value = current_token.int_value;
+        ast->vtype = TYPE_INT;
+        ast->lit.int_value = current_token.int_value;
         next();
         return ast;
     }
     if (current_token.type == TOK_STRING) {
         AST* ast = make_ast(AST_LITERAL);
-        strcpy(ast->str_value, current_token.text);
+        ast->vtype = TYPE_STRING;
+        const char *text = current_token.str ? current_token.str : token_text(&current_token);
+        int length = current_token.str ? (int)strlen(current_token.str) : current_token.length;
+        ast->lit.str_value = ast_str(text, length);
+        free(current_token.str);
+        current_token.str = NULL;
         next();
         return ast;
     }
     if (current_token.type == TOK_TRUE || current_token.type == TOK_FALSE) {
         AST* ast = make_ast(AST_LITERAL);
-        ast->int_value = (current_token.type == TOK_TRUE);
+        ast->vtype = TYPE_BOOL;
+        ast->lit.int_value = (current_token.type == TOK_TRUE);
         next();
         return ast;
     }
     if (current_token.type == TOK_IDENTIFIER) {
-        char tmpname[64];
-        strcpy(tmpname, current_token.text);
+        int tmpsym = current_token.sym;
         next();
         if (current_token.type == TOK_LPAREN) {
-            AST* ast = make_ast(AST_FUNC_CALL);
-            strcpy(ast->name, tmpname);
-            next();
-            ast->children = NULL;
-            ast->children_count = 0;
-            if (current_token.type != TOK_RPAREN) {
-                do {
-                    AST* arg = parse_expr();
-                    ast->children = realloc(ast->children, sizeof(AST*) * (ast->children_count + 1));
-                    ast->children[ast->children_count++] = arg;
-                } while (accept(TOK_COMMA));
-            }
-            expect(TOK_RPAREN);
-            return ast;
+            return parse_call(tmpsym);
         } else {
             AST* ast = make_ast(AST_IDENTIFIER);
-            strcpy(ast->name, tmpname);
+            ast->sym = tmpsym;
             return ast;
         }
     }
@@ -288,8 +379,36 @@ static AST* parse_primary() {
         expect(TOK_RPAREN);
         return e;
     }
-    printf("Syntax error: expected expression\n");
-    exit(1);
+    // spawn f(args) e um AST_FUNC_CALL com outro tipo de no.
+    if (accept(TOK_SPAWN)) {
+        if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected function name after spawn\n"); error_exit(); }
+        int tmpsym = current_token.sym;
+        next();
+        AST* ast = parse_call(tmpsym);
+        ast->type = AST_SPAWN;
+        return ast;
+    }
+    if (accept(TOK_AWAIT)) {
+        AST* ast = make_ast(AST_AWAIT);
+        ast->stmt.expr = parse_primary();
+        return ast;
+    }
+    error_printf("Syntax error: expected expression\n");
+    error_exit();
+}
+
+static AST* parse_call(int sym) {
+    expect(TOK_LPAREN);
+    int mark = scratch_top;
+    if (current_token.type != TOK_RPAREN) {
+        do {
+            scratch_push(parse_expr());
+        } while (accept(TOK_COMMA));
+    }
+    expect(TOK_RPAREN);
+    AST* ast = make_list(AST_FUNC_CALL, mark);
+    ast->sym = sym;
+    return ast;
 }
 
 static int is_binop(TokenType t) {
@@ -298,6 +417,22 @@ static int is_binop(TokenType t) {
            t == TOK_LT || t == TOK_LTE || t == TOK_GT || t == TOK_GTE;
 }
 
+static BinOp binop_kind(TokenType t) {
+    switch (t) {
+        case TOK_PLUS: return OP_ADD;
+        case TOK_MINUS: return OP_SUB;
+        case TOK_STAR: return OP_MUL;
+        case TOK_SLASH: return OP_DIV;
+        case TOK_PERCENT: return OP_MOD;
+        case TOK_EQ: return OP_EQ;
+        case TOK_NEQ: return OP_NEQ;
+        case TOK_LT: return OP_LT;
+        case TOK_LTE: return OP_LTE;
+        case TOK_GT: return OP_GT;
+        default: return OP_GTE;
+    }
+}
+
 static int precedence(TokenType t) {
     switch (t) {
         case TOK_PLUS: case TOK_MINUS: return 1;
@@ -310,21 +445,6 @@ static int precedence(TokenType t) {
 static AST* parse_binop_rhs(int min_prec, AST* lhs) {
     while (is_binop(current_token.type) && precedence(current_token.type) >= min_prec) {
         TokenType op = current_token.type;
-        char opname[3] = {0};
-        switch (op) {
-            case TOK_PLUS: strcpy(opname, "+"); break;
-            case TOK_MINUS: strcpy(opname, "-"); break;
-            case TOK_STAR: strcpy(opname, "*"); break;
-            case TOK_SLASH: strcpy(opname, "/"); break;
-            case TOK_PERCENT: strcpy(opname, "%"); break;
-            case TOK_EQ: strcpy(opname, "=="); break;
-            case TOK_NEQ: strcpy(opname, "!="); break;
-            case TOK_LT: strcpy(opname, "<"); break;
-            case TOK_LTE: strcpy(opname, "<="); break;
-            case TOK_GT: strcpy(opname, ">"); break;
-            case TOK_GTE: strcpy(opname, ">="); break;
-            default: opname[0] = 0;
-        }
         next();
         AST* rhs = parse_primary();
         while (is_binop(current_token.type) &&
@@ -332,9 +452,9 @@ static AST* parse_binop_rhs(int min_prec, AST* lhs) {
             rhs = parse_binop_rhs(precedence(current_token.type), rhs);
         }
         AST* ast = make_ast(AST_BINOP);
-        strcpy(ast->name, opname);
-        ast->left = lhs;
-        ast->right = rhs;
+        ast->op = binop_kind(op);
+        ast->bin.left = lhs;
+        ast->bin.right = rhs;
         lhs = ast;
     }
     return lhs;
@@ -347,11 +467,11 @@ static AST* parse_expr() {
 
 static AST* parse_assignment_inline() {
     AST* ast = make_ast(AST_ASSIGN);
-    if (current_token.type != TOK_IDENTIFIER) { printf("Expected variable name for assignment\n"); exit(1); }
-    strcpy(ast->name, current_token.text);
+    if (current_token.type != TOK_IDENTIFIER) { error_printf("Expected variable name for assignment\n"); error_exit(); }
+    ast->sym = current_token.sym;
     next();
     expect(TOK_ASSIGN);
-    ast->left = parse_expr();
+    ast->stmt.expr = parse_expr();
     return ast;
 }
 
@@ -368,3 +488,100 @@ AST* parse_program(void) {
     return parse_program_node();
 }
 
+static const char *binop_name(int op) {
+    static const char *names[] = { "+", "-", "*", "/", "%", "==", "!=", "<", "<=", ">", ">=" };
+    return names[op];
+}
+
+static void dump_node(AST *ast, int indent) {
+    printf("%*s", indent * 2, "");
+    if (!ast) { printf("(null)\n"); return; }
+    switch (ast->type) {
+        case AST_PROGRAM:
+            printf("block\n");
+            for (int i = 0; i < ast->list.count; i++) dump_node(ast->list.items[i], indent + 1);
+            break;
+        case AST_VAR_DECL:
+            printf("var %s: %s\n", sym_name(ast->sym), sym_name(ast->stmt.type_sym));
+            if (ast->stmt.expr) dump_node(ast->stmt.expr, indent + 1);
+            break;
+        case AST_ASSIGN:
+            printf("assign %s\n", sym_name(ast->sym));
+            dump_node(ast->stmt.expr, indent + 1);
+            break;
+        case AST_FUNC_DECL:
+            printf("func %s(", sym_name(ast->sym));
+            for (int i = 0; i < ast->func.params_count; i++)
+                printf("%s%s: %s", i ? ", " : "", sym_name(ast->func.params[i].name), sym_name(ast->func.params[i].type));
+            printf("): %s\n", sym_name(ast->func.type_sym));
+            dump_node(ast->func.body, indent + 1);
+            break;
+        case AST_FUNC_CALL:
+            printf("call %s\n", sym_name(ast->sym));
+            for (int i = 0; i < ast->list.count; i++) dump_node(ast->list.items[i], indent + 1);
+            break;
+        case AST_SPAWN:
+            printf("spawn %s\n", sym_name(ast->sym));
+            for (int i = 0; i < ast->list.count; i++) dump_node(ast->list.items[i], indent + 1);
+            break;
+        case AST_AWAIT:
+            printf("await\n");
+            dump_node(ast->stmt.expr, indent + 1);
+            break;
+        case AST_CONCAT:
+            printf("concat\n");
+            for (int i = 0; i < ast->list.count; i++) dump_node(ast->list.items[i], indent + 1);
+            break;
+        case AST_IF:
+            printf("if\n");
+            dump_node(ast->branch.cond, indent + 1);
+            dump_node(ast->branch.then_body, indent + 1);
+            if (ast->branch.else_body) dump_node(ast->branch.else_body, indent + 1);
+            break;
+        case AST_WHILE:
+            printf("while\n");
+            dump_node(ast->loop.cond, indent + 1);
+            dump_node(ast->loop.body, indent + 1);
+            break;
+        case AST_FOR:
+            printf("for\n");
+            dump_node(ast->loop.init, indent + 1);
+            dump_node(ast->loop.cond, indent + 1);
+            dump_node(ast->loop.incr, indent + 1);
+            dump_node(ast->loop.body, indent + 1);
+            break;
+        case AST_PARALLEL_FOR:
+            if (ast->par.reduce) printf("parallel reduce sum %s\n", sym_name(ast->par.reduce->sym));
+            else printf("parallel\n");
+            dump_node(ast->par.loop, indent + 1);
+            break;
+        case AST_PRINT:
+            printf("print\n");
+            dump_node(ast->stmt.expr, indent + 1);
+            break;
+        case AST_INPUT:
+            printf("input %s\n", sym_name(ast->sym));
+            break;
+        case AST_RETURN:
+            printf("return\n");
+            dump_node(ast->stmt.expr, indent + 1);
+            break;
+        case AST_BINOP:
+            printf("%s\n", binop_name(ast->op));
+            dump_node(ast->bin.left, indent + 1);
+            dump_node(ast->bin.right, indent + 1);
+            break;
+        case AST_LITERAL:
+            if (ast->vtype == TYPE_STRING) printf("\"%s\"\n", ast->lit.str_value->chars);
+            else if (ast->vtype == TYPE_BOOL) printf("%s\n", ast->lit.int_value ? "true" : "false");
+            else printf("%d\n", ast->lit.int_value);
+            break;
+        case AST_IDENTIFIER:
+            printf("%s\n", sym_name(ast->sym));
+            break;
+    }
+}
+
+void dump_ast(AST *ast) {
+    dump_node(ast, 0);
+}
@@ -1,5 +1,8 @@
 #ifndef PARSER_H
 #define PARSER_H
+#include <stddef.h>
+#include "str.h"
+#include "arena.h"
 
 typedef enum {
     AST_PROGRAM,
@@ -15,32 +18,111 @@ typedef enum {
     AST_RETURN,
     AST_BINOP,
     AST_LITERAL,
-    AST_IDENTIFIER
+    AST_IDENTIFIER,
+    AST_CONCAT,         // criado pelo optimize: cadeia de + entre strings
+    AST_PARALLEL_FOR,   // `parallel for`: um AST_FOR e a variavel de `reduce sum`
+    AST_SPAWN,          // `spawn f(args)`: mesma forma de AST_FUNC_CALL
+    AST_AWAIT,          // `await h`: o handle em stmt.expr
+    // Variantes especializadas pelo interpretador na primeira execucao do no
+    // (quickening), conforme os tipos de valor que ele ve; mantem a variante
+    // da uniao do no original e voltam ao generico se os tipos mudarem.
+    AST_Q_ADD_INT,      // AST_BINOP com dois ints, um por BinOp (mesma ordem)
+    AST_Q_SUB_INT, AST_Q_MUL_INT, AST_Q_DIV_INT, AST_Q_MOD_INT,
+    AST_Q_EQ_INT, AST_Q_NEQ_INT, AST_Q_LT_INT, AST_Q_LTE_INT, AST_Q_GT_INT, AST_Q_GTE_INT,
+    AST_Q_ADD_STR,      // AST_BINOP + com string de um dos lados
+    AST_Q_BINOP,        // AST_BINOP sem especializacao (ou desotimizado)
+    AST_Q_LOCAL,        // AST_IDENTIFIER no frame atual
+    AST_Q_GLOBAL,       // AST_IDENTIFIER global
+    AST_Q_CALL          // AST_FUNC_CALL sem memo nem JIT: chamada direta
 } ASTType;
 
+typedef enum {
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+    OP_EQ, OP_NEQ, OP_LT, OP_LTE, OP_GT, OP_GTE
+} BinOp;
+
+// AST_ASSIGN marcado pelo optimize: `x = x + a + b ...` com x string e
+// operandos que nao leem x nem chamam funcoes. A expressao e um AST_CONCAT
+// que comeca por x; a execucao anexa os demais itens a x.
+#define ASSIGN_APPEND 1
+
+// AST_VAR_DECL deixado pelo optimize no lugar de um ramo removido: blocos
+// nao abrem escopo, entao a variavel continua declarada (tem slot e tipo),
+// mas, como no ramo que nunca roda, nada e executado e ela fica vazia.
+#define DECL_ONLY 1
+
+// AST_FOR marcado pelo passe de lacos (loops.c): laco contado, com a variavel
+// de inducao local int escrita so no incremento `i = i +/- c`, e a condicao
+// `i <op> limite` com limite literal ou local nao escrito no laco.
+#define FOR_COUNTED 1
+
+// Tipo do valor de um literal.
+typedef enum {
+    TYPE_NONE,
+    TYPE_INT,
+    TYPE_STRING,
+    TYPE_BOOL,
+    TYPE_TASK           // handle devolvido por spawn
+} TypeKind;
+
+// Onde vive uma variavel resolvida: no frame da funcao em execucao (ou do
+// codigo de topo) ou no vetor de globais.
+typedef enum {
+    SLOT_LOCAL,
+    SLOT_GLOBAL
+} SlotDepth;
+
 typedef struct {
-    char name[64];
-    char type[16];
+    int name;
+    int type;
 } Param;
 
-typedef struct AST {
-    ASTType type;
-    char name[64];
-    char str_value[256];    
-    int int_value;          
-    int children_count;
-    struct AST **children;  
-    struct AST *left, *right;
-    struct AST *cond, *then_body, *else_body, *body, *init, *incr;
-    struct AST *params_list;
-    int params_count;
-    Param params[8];
-    struct AST *block; 
-    struct AST *left_return;
-} AST;
+typedef struct AST AST;
+
+// Cada no e alocado na arena do parser com o tamanho exato da sua variante:
+// o cabecalho (tipo, operador, nome internado) mais o membro da uniao usado
+// pelo seu ASTType. Listas (blocos, argumentos) ficam logo apos o no.
+struct AST {
+    unsigned char type;     // ASTType
+    unsigned char op;       // BinOp, em AST_BINOP; ASSIGN_APPEND em AST_ASSIGN; DECL_ONLY em
+                            // AST_VAR_DECL; FOR_COUNTED em AST_FOR
+    unsigned char vtype;    // TypeKind: literais no parser, demais expressoes no typecheck;
+                            // em VAR_DECL/ASSIGN/INPUT, o tipo da variavel
+    unsigned char depth;    // SlotDepth de variaveis, preenchido pelo resolve
+    int sym;                // nome internado: variavel, funcao ou identificador
+    int line, col;          // posicao no fonte: do primeiro token nos comandos,
+                            // do token corrente ao criar o no nas expressoes;
+                            // 0 em nos criados pelos passes de otimizacao
+    union {
+        struct { int int_value; Str *str_value; } lit;                  // AST_LITERAL
+        struct { AST *left, *right; } bin;                              // AST_BINOP
+        struct { int slot; } var;                                       // AST_IDENTIFIER, AST_INPUT
+        struct { AST *expr; int type_sym; int slot; } stmt;             // VAR_DECL, ASSIGN, PRINT, RETURN, AWAIT
+        struct { int count; int index; AST **items; } list;             // PROGRAM (blocos), FUNC_CALL e SPAWN (index: funcao ligada), CONCAT
+        struct { AST *cond, *then_body, *else_body; } branch;           // AST_IF
+        struct { AST *cond, *body, *init, *incr; } loop;                // AST_WHILE, AST_FOR
+        struct { AST *loop; AST *reduce; } par;                         // AST_PARALLEL_FOR (reduce: IDENTIFIER ou NULL)
+        struct { AST *body; Param *params; int params_count; int type_sym; int locals; } func; // AST_FUNC_DECL
+    };
+};
+
+// Tipo original de um no, para quem percorre a AST depois que a execucao
+// ja comecou (o JIT compila funcoes no meio dela).
+static inline int ast_kind(const AST *ast) {
+    if (ast->type < AST_Q_ADD_INT) return ast->type;
+    if (ast->type <= AST_Q_BINOP) return AST_BINOP;
+    return ast->type == AST_Q_CALL ? AST_FUNC_CALL : AST_IDENTIFIER;
+}
 
 void init_lexer(const char *src);
 AST* parse_program(void);
+AST* ast_new(ASTType type);
+AST* ast_new_list(ASTType type, AST **items, int count);
+Str* ast_str(const char *s, int len);
+size_t ast_size(ASTType type);    // bytes do no sem os itens de lista
+void dump_ast(AST *ast);
 void free_ast(AST *ast);
+void ast_take_arena(Arena *out);
+size_t ast_memory_used(void);
 
-#endif
\ No newline at end of file
+#endif
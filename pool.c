@@ -0,0 +1,249 @@
+#include "pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define DEQUE_INITIAL 256       // potencia de 2
+#define IDLE_SPINS 64           // tentativas de roubo antes de dormir
+
+// Vetor circular da deque; cresce pelo dono. Os vetores antigos ficam numa
+// lista ate o fim do pool, porque um ladrao pode ainda estar lendo deles.
+typedef struct DequeBuf DequeBuf;
+struct DequeBuf {
+    long cap;
+    DequeBuf *old;
+    _Atomic(Task*) items[];
+};
+
+typedef struct {
+    atomic_long top, bottom;
+    _Atomic(DequeBuf*) buf;
+} Deque;
+
+typedef struct {
+    Pool *pool;
+    int id;
+    pthread_t thread;
+    Deque deque;
+} Worker;
+
+struct Pool {
+    int size;
+    Worker *workers;
+    atomic_long queued;         // tarefas empilhadas e ainda nao retiradas
+    atomic_int sleepers;
+    atomic_int shutdown;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+};
+
+static _Thread_local Worker *self;
+static _Thread_local unsigned rng = 2463534242u;
+
+static DequeBuf *buf_new(long cap) {
+    DequeBuf *b = malloc(sizeof(DequeBuf) + sizeof(Task*) * cap);
+    b->cap = cap;
+    b->old = NULL;
+    return b;
+}
+
+static void deque_init(Deque *d) {
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    atomic_init(&d->buf, buf_new(DEQUE_INITIAL));
+}
+
+static void deque_free(Deque *d) {
+    DequeBuf *b = atomic_load(&d->buf);
+    while (b) {
+        DequeBuf *old = b->old;
+        free(b);
+        b = old;
+    }
+}
+
+static DequeBuf *deque_grow(Deque *d, DequeBuf *a, long t, long b) {
+    DequeBuf *n = buf_new(a->cap * 2);
+    for (long i = t; i < b; i++)
+        atomic_store_explicit(&n->items[i & (n->cap - 1)],
+                              atomic_load_explicit(&a->items[i & (a->cap - 1)], memory_order_relaxed),
+                              memory_order_relaxed);
+    n->old = a;
+    atomic_store_explicit(&d->buf, n, memory_order_release);
+    return n;
+}
+
+// Operacoes do dono (fundo da deque).
+static void deque_push(Deque *d, Task *task) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    DequeBuf *a = atomic_load_explicit(&d->buf, memory_order_relaxed);
+    if (b - t > a->cap - 1) a = deque_grow(d, a, t, b);
+    atomic_store_explicit(&a->items[b & (a->cap - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+}
+
+static Task *deque_take(Deque *d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    DequeBuf *a = atomic_load_explicit(&d->buf, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    Task *task = atomic_load_explicit(&a->items[b & (a->cap - 1)], memory_order_relaxed);
+    if (t == b) {
+        // Ultima tarefa: disputa com os ladroes pelo topo.
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            task = NULL;
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+// Operacao dos ladroes (topo da deque).
+static Task *deque_steal(Deque *d) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+    DequeBuf *a = atomic_load_explicit(&d->buf, memory_order_acquire);
+    Task *task = atomic_load_explicit(&a->items[t & (a->cap - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+    return task;
+}
+
+int pool_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+static Task *find_task(Pool *pool, Worker *w) {
+    Task *task = deque_take(&w->deque);
+    if (task) return task;
+    // Rouba a partir de uma vitima aleatoria, para espalhar a disputa.
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    int start = (int)(rng % (unsigned)pool->size);
+    for (int i = 0; i < pool->size; i++) {
+        Worker *victim = &pool->workers[(start + i) % pool->size];
+        if (victim == w) continue;
+        task = deque_steal(&victim->deque);
+        if (task) return task;
+    }
+    return NULL;
+}
+
+static void run_task(Pool *pool, Task *task) {
+    atomic_fetch_sub(&pool->queued, 1);
+    task->run(task);
+}
+
+int pool_help(Pool *pool) {
+    if (!self || self->pool != pool) return 0;
+    Task *task = find_task(pool, self);
+    if (!task) return 0;
+    run_task(pool, task);
+    return 1;
+}
+
+int pool_help_oldest(Pool *pool) {
+    if (!self || self->pool != pool) return 0;
+    // O roubo falha se outro ladrao levou o mesmo topo; ai vale qualquer uma.
+    Task *task = deque_steal(&self->deque);
+    if (!task) task = find_task(pool, self);
+    if (!task) return 0;
+    run_task(pool, task);
+    return 1;
+}
+
+void pool_push(Pool *pool, Task *task) {
+    if (!self || self->pool != pool) {
+        task->run(task);
+        return;
+    }
+    atomic_fetch_add(&pool->queued, 1);
+    deque_push(&self->deque, task);
+    if (atomic_load(&pool->sleepers) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    Pool *pool = w->pool;
+    self = w;
+    rng += (unsigned)w->id * 2654435761u;
+    int idle = 0;
+    while (!atomic_load(&pool->shutdown)) {
+        Task *task = find_task(pool, w);
+        if (task) {
+            run_task(pool, task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            sched_yield();
+            continue;
+        }
+        // Dorme ate haver tarefa: quem empilha incrementa `queued` antes de
+        // olhar `sleepers`, e aqui e o contrario, entao o sinal nao se perde.
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->sleepers, 1);
+        while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->shutdown))
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        atomic_fetch_sub(&pool->sleepers, 1);
+        pthread_mutex_unlock(&pool->lock);
+        idle = 0;
+    }
+    return NULL;
+}
+
+Pool *pool_new(int threads) {
+    if (threads < 1) threads = 1;
+    Pool *pool = calloc(1, sizeof(Pool));
+    pool->size = threads;
+    pool->workers = calloc(threads, sizeof(Worker));
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->shutdown, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    for (int i = 0; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        deque_init(&pool->workers[i].deque);
+    }
+    self = &pool->workers[0];
+    for (int i = 1; i < threads; i++)
+        pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]);
+    return pool;
+}
+
+int pool_size(Pool *pool) {
+    return pool->size;
+}
+
+void pool_free(Pool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->shutdown, 1);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->size; i++) pthread_join(pool->workers[i].thread, NULL);
+    for (int i = 0; i < pool->size; i++) deque_free(&pool->workers[i].deque);
+    if (self && self->pool == pool) self = NULL;
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->workers);
+    free(pool);
+}
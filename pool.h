@@ -0,0 +1,36 @@
+#ifndef POOL_H
+#define POOL_H
+
+// Conjunto fixo de threads com roubo de trabalho. Cada thread tem sua deque
+// de tarefas (Chase-Lev): empilha e desempilha no fundo sem travas, e as
+// outras roubam do topo quando a propria esvazia. A thread que cria o pool
+// e o trabalhador 0: ela empilha e, enquanto espera algum resultado, executa
+// tarefas com pool_help. Trabalhadores sem nada a fazer dormem ate a
+// proxima tarefa.
+
+// Tarefa intrusiva: quem empilha embute um Task na sua propria estrutura e
+// recupera o resto a partir do ponteiro; o pool nao aloca por tarefa.
+typedef struct Task Task;
+struct Task {
+    void (*run)(Task *task);
+};
+
+typedef struct Pool Pool;
+
+// Processadores disponiveis (pelo menos 1).
+int pool_cpu_count(void);
+// `threads` trabalhadores no total, contando a thread que chama.
+Pool *pool_new(int threads);
+int pool_size(Pool *pool);
+// Empilha na deque da thread atual, que deve ser um trabalhador do pool
+// (fora dele, a tarefa roda na hora).
+void pool_push(Pool *pool, Task *task);
+// Executa uma tarefa pendente (da propria deque ou roubada); 0 se nao havia.
+int pool_help(Pool *pool);
+// Como pool_help, mas tira da propria deque a tarefa mais antiga (pelo topo,
+// como um ladrao): quem empilha uma fila de tarefas as executa em ordem.
+int pool_help_oldest(Pool *pool);
+// Libera o pool; chamado pelo trabalhador 0 depois que as tarefas acabaram.
+void pool_free(Pool *pool);
+
+#endif
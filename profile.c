@@ -0,0 +1,309 @@
+#include "profile.h"
+#include "symtab.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+_Thread_local int profile_enabled;
+
+typedef struct {
+    long count;
+    long long incl, excl;   // nanossegundos
+    int active;             // execucoes em andamento (recursao)
+} Stat;
+
+typedef struct {
+    AST *ast;
+    Stat stat;
+} StmtStat;
+
+// Comando em execucao; `child` soma o tempo dos comandos aninhados.
+typedef struct {
+    int stmt, line;
+    long long start, child;
+} StmtFrame;
+
+// Chamada em execucao; `child` soma o tempo das chamadas feitas por ela.
+typedef struct {
+    int func, node;
+    long long start, child;
+} CallFrame;
+
+// No da arvore de pilhas: o 0 e o codigo de topo; cada filho e uma funcao
+// chamada a partir da pilha do pai.
+typedef struct {
+    int func, parent, first, next;
+    long long excl;
+} StackNode;
+
+static _Thread_local AST **decls;           // index -> AST_FUNC_DECL
+static _Thread_local Stat *funcs;
+static _Thread_local int func_count;
+// Comandos em vetor denso (indice estavel) e tabela de hash AST* -> indice.
+static _Thread_local StmtStat *stmts;
+static _Thread_local int stmt_count, stmt_cap;
+static _Thread_local int *table;
+static _Thread_local int table_cap;
+static _Thread_local Stat *lines;
+static _Thread_local int line_cap;
+static _Thread_local StmtFrame *sframes;
+static _Thread_local int sframe_count, sframe_cap;
+static _Thread_local CallFrame *cframes;
+static _Thread_local int cframe_count, cframe_cap;
+static _Thread_local StackNode *nodes;
+static _Thread_local int node_count, node_cap;
+static _Thread_local long long total;       // tempo do codigo de topo, ao terminar
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void close_stat(Stat *s, long long elapsed, long long self) {
+    s->excl += self;
+    if (--s->active == 0) s->incl += elapsed;
+}
+
+static unsigned int hash_ptr(AST *ast) {
+    unsigned long long k = (unsigned long long)(size_t)ast;
+    return (unsigned int)((k >> 3) * 0x9E3779B97F4A7C15ULL >> 32);
+}
+
+static void table_insert(int id) {
+    unsigned int mask = (unsigned int)table_cap - 1, i = hash_ptr(stmts[id].ast) & mask;
+    while (table[i] >= 0) i = (i + 1) & mask;
+    table[i] = id;
+}
+
+static int stmt_id(AST *ast) {
+    unsigned int mask = (unsigned int)table_cap - 1, i = hash_ptr(ast) & mask;
+    for (; table[i] >= 0; i = (i + 1) & mask)
+        if (stmts[table[i]].ast == ast) return table[i];
+    if (stmt_count == stmt_cap) {
+        stmt_cap *= 2;
+        stmts = realloc(stmts, sizeof(StmtStat) * stmt_cap);
+    }
+    int id = stmt_count++;
+    memset(&stmts[id], 0, sizeof(StmtStat));
+    stmts[id].ast = ast;
+    if (stmt_count * 2 > table_cap) {
+        free(table);
+        table_cap *= 2;
+        table = malloc(sizeof(int) * table_cap);
+        memset(table, -1, sizeof(int) * table_cap);
+        for (int j = 0; j < stmt_count; j++) table_insert(j);
+    } else {
+        table[i] = id;
+    }
+    return id;
+}
+
+static int stack_child(int parent, int func) {
+    for (int n = nodes[parent].first; n >= 0; n = nodes[n].next)
+        if (nodes[n].func == func) return n;
+    if (node_count == node_cap) {
+        node_cap *= 2;
+        nodes = realloc(nodes, sizeof(StackNode) * node_cap);
+    }
+    int n = node_count++;
+    nodes[n] = (StackNode){ func, parent, -1, nodes[parent].first, 0 };
+    nodes[parent].first = n;
+    return n;
+}
+
+void profile_init(AST *program) {
+    decls = malloc(sizeof(AST*) * (program->list.count + 1));
+    func_count = 0;
+    for (int i = 0; i < program->list.count; i++)
+        if (program->list.items[i]->type == AST_FUNC_DECL) decls[func_count++] = program->list.items[i];
+    funcs = calloc(func_count + 1, sizeof(Stat));
+    stmt_cap = 256;
+    stmt_count = 0;
+    stmts = malloc(sizeof(StmtStat) * stmt_cap);
+    table_cap = 512;
+    table = malloc(sizeof(int) * table_cap);
+    memset(table, -1, sizeof(int) * table_cap);
+    line_cap = 256;
+    lines = calloc(line_cap, sizeof(Stat));
+    sframe_cap = cframe_cap = 64;
+    sframe_count = 0;
+    sframes = malloc(sizeof(StmtFrame) * sframe_cap);
+    cframes = malloc(sizeof(CallFrame) * cframe_cap);
+    node_cap = 64;
+    node_count = 1;
+    nodes = malloc(sizeof(StackNode) * node_cap);
+    nodes[0] = (StackNode){ -1, -1, -1, -1, 0 };
+    cframes[0] = (CallFrame){ -1, 0, now_ns(), 0 };
+    cframe_count = 1;
+    total = -1;
+}
+
+void profile_enter(AST *stmt) {
+    int id = stmt_id(stmt), line = stmt->line;
+    if (line >= line_cap) {
+        int cap = line_cap;
+        while (line >= line_cap) line_cap *= 2;
+        lines = realloc(lines, sizeof(Stat) * line_cap);
+        memset(lines + cap, 0, sizeof(Stat) * (line_cap - cap));
+    }
+    if (sframe_count == sframe_cap) {
+        sframe_cap *= 2;
+        sframes = realloc(sframes, sizeof(StmtFrame) * sframe_cap);
+    }
+    stmts[id].stat.count++;
+    stmts[id].stat.active++;
+    lines[line].count++;
+    lines[line].active++;
+    sframes[sframe_count++] = (StmtFrame){ id, line, now_ns(), 0 };
+}
+
+void profile_exit(void) {
+    long long t = now_ns();
+    StmtFrame *f = &sframes[--sframe_count];
+    long long elapsed = t - f->start, self = elapsed - f->child;
+    close_stat(&stmts[f->stmt].stat, elapsed, self);
+    close_stat(&lines[f->line], elapsed, self);
+    if (sframe_count) sframes[sframe_count - 1].child += elapsed;
+}
+
+void profile_call(int index) {
+    if (cframe_count == cframe_cap) {
+        cframe_cap *= 2;
+        cframes = realloc(cframes, sizeof(CallFrame) * cframe_cap);
+    }
+    int node = stack_child(cframes[cframe_count - 1].node, index);
+    funcs[index].count++;
+    funcs[index].active++;
+    cframes[cframe_count++] = (CallFrame){ index, node, now_ns(), 0 };
+}
+
+void profile_return(void) {
+    long long t = now_ns();
+    CallFrame *f = &cframes[--cframe_count];
+    long long elapsed = t - f->start, self = elapsed - f->child;
+    close_stat(&funcs[f->func], elapsed, self);
+    nodes[f->node].excl += self;
+    cframes[cframe_count - 1].child += elapsed;
+}
+
+// Fecha o codigo de topo na primeira vez que o resultado e pedido.
+static void finish(void) {
+    if (total >= 0) return;
+    CallFrame *f = &cframes[0];
+    total = now_ns() - f->start;
+    nodes[0].excl += total - f->child;
+}
+
+// ---- Relatorio ----
+
+static const char *stmt_kind(AST *ast) {
+    switch (ast->type) {
+        case AST_VAR_DECL: return "var";
+        case AST_ASSIGN: return "assign";
+        case AST_FUNC_CALL:
+        case AST_Q_CALL: return "call";
+        case AST_IF: return "if";
+        case AST_WHILE: return "while";
+        case AST_FOR: return "for";
+        case AST_PARALLEL_FOR: return "parallel for";
+        case AST_PRINT: return "print";
+        case AST_RETURN: return "return";
+        default: return "expr";
+    }
+}
+
+typedef struct {
+    const Stat *stat;
+    char label[80];
+} Row;
+
+static int cmp_row(const void *a, const void *b) {
+    long long x = ((const Row*)a)->stat->excl, y = ((const Row*)b)->stat->excl;
+    return x < y ? 1 : -(x > y);
+}
+
+static void print_rows(FILE *out, const char *title, Row *rows, int n, int limit) {
+    qsort(rows, n, sizeof(Row), cmp_row);
+    fprintf(out, "profile: %-24s %12s %12s %12s %7s\n", title, "count", "incl ms", "excl ms", "excl%");
+    for (int i = 0; i < n && i < limit; i++) {
+        const Stat *s = rows[i].stat;
+        fprintf(out, "profile: %-24s %12ld %12.3f %12.3f %6.1f%%\n", rows[i].label, s->count,
+                s->incl / 1e6, s->excl / 1e6, total > 0 ? 100.0 * s->excl / total : 0.0);
+    }
+    if (n > limit) fprintf(out, "profile: ... %d more\n", n - limit);
+}
+
+void profile_report(FILE *out) {
+    finish();
+    fprintf(out, "profile: total %.3f ms\n", total / 1e6);
+    int max = func_count + 1;
+    if (stmt_count > max) max = stmt_count;
+    if (line_cap > max) max = line_cap;
+    Row *rows = malloc(sizeof(Row) * max);
+
+    Stat top = { 1, total, nodes[0].excl, 0 };
+    int n = 0;
+    rows[n].stat = &top;
+    snprintf(rows[n++].label, sizeof(rows[0].label), "<top>");
+    for (int i = 0; i < func_count; i++) {
+        if (!funcs[i].count) continue;
+        rows[n].stat = &funcs[i];
+        snprintf(rows[n++].label, sizeof(rows[0].label), "%s", sym_name(decls[i]->sym));
+    }
+    print_rows(out, "function", rows, n, n);
+
+    n = 0;
+    for (int i = 1; i < line_cap; i++) {
+        if (!lines[i].count) continue;
+        rows[n].stat = &lines[i];
+        snprintf(rows[n++].label, sizeof(rows[0].label), "line %d", i);
+    }
+    print_rows(out, "line", rows, n, PROFILE_TOP);
+
+    for (int i = 0; i < stmt_count; i++) {
+        AST *ast = stmts[i].ast;
+        rows[i].stat = &stmts[i].stat;
+        snprintf(rows[i].label, sizeof(rows[0].label), "%d:%d %s", ast->line, ast->col, stmt_kind(ast));
+    }
+    print_rows(out, "statement", rows, stmt_count, PROFILE_TOP);
+    free(rows);
+}
+
+static void print_stack(FILE *out, int node) {
+    if (nodes[node].parent >= 0) {
+        print_stack(out, nodes[node].parent);
+        fprintf(out, ";%s", sym_name(decls[nodes[node].func]->sym));
+    } else {
+        fputs("<top>", out);
+    }
+}
+
+void profile_folded(FILE *out) {
+    finish();
+    for (int i = 0; i < node_count; i++) {
+        long long micros = (nodes[i].excl + 500) / 1000;
+        if (micros <= 0) continue;
+        print_stack(out, i);
+        fprintf(out, " %lld\n", micros);
+    }
+}
+
+void profile_free(void) {
+    free(decls);
+    free(funcs);
+    free(stmts);
+    free(table);
+    free(lines);
+    free(sframes);
+    free(cframes);
+    free(nodes);
+    decls = NULL;
+    funcs = NULL;
+    stmts = NULL;
+    table = NULL;
+    lines = NULL;
+    sframes = NULL;
+    cframes = NULL;
+    nodes = NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <stdio.h>
+#include "parser.h"
+
+// Profiler por instrumentacao (--profile): o interpretador de arvore avisa
+// o inicio e o fim de cada comando e de cada chamada de funcao. Para cada
+// comando, linha e funcao conta execucoes, tempo inclusivo (com o que roda
+// dentro: comandos aninhados e chamadas) e exclusivo (so o proprio). Numa
+// recursao o inclusivo conta so a execucao mais externa. As pilhas de
+// chamadas ficam numa arvore para o formato "folded" (flamegraph.pl,
+// speedscope). Desligado, o custo e um teste de in->profile por comando.
+
+#define PROFILE_TOP 20      // linhas e comandos no relatorio
+
+// Comeca a medir; `program` ja resolvido (funcoes na ordem de declaracao).
+void profile_init(AST *program);
+void profile_enter(AST *stmt);
+void profile_exit(void);
+void profile_call(int index);
+void profile_return(void);
+// Tabelas ordenadas pelo tempo exclusivo.
+void profile_report(FILE *out);
+// Uma linha por pilha: `<top>;f;g micros`, com o tempo exclusivo de g.
+void profile_folded(FILE *out);
+void profile_free(void);
+
+extern _Thread_local int profile_enabled;
+
+#endif
@@ -0,0 +1,224 @@
+#include "resolve.h"
+#include "errors.h"
+#include "symtab.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Escopo lexico: uma funcao enxerga seus parametros e locais e as globais.
+// Apenas funcoes e `for` abrem escopo; blocos de if/while nao. O codigo de
+// topo fora de `for` declara globais. Slots de um `for` sao reaproveitados
+// depois que ele termina, entao o frame tem o tamanho do maior aninhamento.
+
+typedef struct {
+    int sym;
+    int slot;
+} Local;
+
+static _Thread_local Local *locals;
+static _Thread_local int local_count, local_cap;
+static _Thread_local int scope_start;     // primeiro local do escopo mais interno
+static _Thread_local int scope_depth;     // escopos de `for` abertos no codigo de topo
+static _Thread_local int next_slot, max_slot;
+static _Thread_local int in_function;
+static _Thread_local int *global_slot;    // sym -> slot global, ou -1
+static _Thread_local int global_count;
+static _Thread_local AST **func_decl;     // sym -> declaracao da funcao
+static _Thread_local int *func_index;     // sym -> posicao da declaracao, ou -1
+
+static int find_local(int sym) {
+    for (int i = local_count - 1; i >= 0; i--)
+        if (locals[i].sym == sym) return locals[i].slot;
+    return -1;
+}
+
+static int add_local(int sym) {
+    for (int i = scope_start; i < local_count; i++)
+        if (locals[i].sym == sym) return locals[i].slot;
+    if (local_count == local_cap) {
+        local_cap = local_cap ? local_cap * 2 : 32;
+        locals = realloc(locals, sizeof(Local) * local_cap);
+    }
+    locals[local_count].sym = sym;
+    locals[local_count].slot = next_slot++;
+    if (next_slot > max_slot) max_slot = next_slot;
+    return locals[local_count++].slot;
+}
+
+// Resolve um uso de `sym`; devolve o slot e grava a profundidade no no.
+static int resolve_use(AST *ast) {
+    int slot = find_local(ast->sym);
+    if (slot >= 0) {
+        ast->depth = SLOT_LOCAL;
+        return slot;
+    }
+    if (global_slot[ast->sym] >= 0) {
+        ast->depth = SLOT_GLOBAL;
+        return global_slot[ast->sym];
+    }
+    error_printf("Undefined variable: %s\n", sym_name(ast->sym));
+    error_exit();
+}
+
+static void resolve_expr(AST *ast) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_IDENTIFIER:
+            ast->var.slot = resolve_use(ast);
+            break;
+        case AST_BINOP:
+            resolve_expr(ast->bin.left);
+            resolve_expr(ast->bin.right);
+            break;
+        case AST_CONCAT:
+            for (int i = 0; i < ast->list.count; i++)
+                resolve_expr(ast->list.items[i]);
+            break;
+        case AST_AWAIT:
+            resolve_expr(ast->stmt.expr);
+            break;
+        case AST_FUNC_CALL:
+        case AST_SPAWN: {
+            int idx = func_index[ast->sym];
+            if (idx < 0) { error_printf("Undefined function: %s\n", sym_name(ast->sym)); error_exit(); }
+            AST *decl = func_decl[ast->sym];
+            if (ast->list.count != decl->func.params_count) {
+                error_printf("Function %s expects %d arguments, got %d\n", sym_name(ast->sym), decl->func.params_count, ast->list.count);
+                error_exit();
+            }
+            ast->list.index = idx;
+            for (int i = 0; i < ast->list.count; i++)
+                resolve_expr(ast->list.items[i]);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void resolve_stmt(AST *ast) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                resolve_stmt(ast->list.items[i]);
+            break;
+        case AST_VAR_DECL:
+            resolve_expr(ast->stmt.expr);
+            if (!in_function && scope_depth == 0) {
+                if (global_slot[ast->sym] < 0) global_slot[ast->sym] = global_count++;
+                ast->depth = SLOT_GLOBAL;
+                ast->stmt.slot = global_slot[ast->sym];
+            } else {
+                ast->depth = SLOT_LOCAL;
+                ast->stmt.slot = add_local(ast->sym);
+            }
+            break;
+        case AST_ASSIGN:
+            resolve_expr(ast->stmt.expr);
+            ast->stmt.slot = resolve_use(ast);
+            break;
+        case AST_PRINT:
+        case AST_RETURN:
+            resolve_expr(ast->stmt.expr);
+            break;
+        case AST_INPUT:
+            ast->var.slot = resolve_use(ast);
+            break;
+        case AST_FUNC_CALL:
+            resolve_expr(ast);
+            break;
+        case AST_IF:
+            resolve_expr(ast->branch.cond);
+            resolve_stmt(ast->branch.then_body);
+            resolve_stmt(ast->branch.else_body);
+            break;
+        case AST_WHILE:
+            resolve_expr(ast->loop.cond);
+            resolve_stmt(ast->loop.body);
+            break;
+        case AST_FOR: {
+            int saved_start = scope_start, saved_count = local_count, saved_slot = next_slot;
+            scope_start = local_count;
+            scope_depth++;
+            resolve_stmt(ast->loop.init);
+            resolve_expr(ast->loop.cond);
+            resolve_stmt(ast->loop.body);
+            resolve_stmt(ast->loop.incr);
+            scope_depth--;
+            scope_start = saved_start;
+            local_count = saved_count;
+            next_slot = saved_slot;
+            break;
+        }
+        case AST_PARALLEL_FOR:
+            if (ast->par.reduce) resolve_expr(ast->par.reduce);
+            resolve_stmt(ast->par.loop);
+            break;
+        default:
+            break;
+    }
+}
+
+static void begin_frame(void) {
+    local_count = scope_start = scope_depth = 0;
+    next_slot = max_slot = 0;
+}
+
+Frames resolve(AST *program) {
+    Frames frames;
+    int nsyms = sym_count();
+    // Um erro numa carga de MacsContext volta ao setjmp sem passar pelo fim.
+    free(global_slot);
+    free(func_index);
+    free(func_decl);
+    global_slot = malloc(sizeof(int) * nsyms);
+    func_index = malloc(sizeof(int) * nsyms);
+    func_decl = malloc(sizeof(AST*) * nsyms);
+    for (int i = 0; i < nsyms; i++) global_slot[i] = func_index[i] = -1;
+    global_count = 0;
+
+    // Como no interpretador, a ultima declaracao de um nome prevalece.
+    int n = 0;
+    for (int i = 0; i < program->list.count; i++) {
+        AST *decl = program->list.items[i];
+        if (decl->type != AST_FUNC_DECL) continue;
+        func_index[decl->sym] = n++;
+        func_decl[decl->sym] = decl;
+    }
+
+    // Codigo de topo primeiro: assim todas as globais ja tem slot quando os
+    // corpos das funcoes sao resolvidos.
+    begin_frame();
+    in_function = 0;
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type != AST_FUNC_DECL)
+            resolve_stmt(stmt);
+    }
+    frames.main_locals = max_slot;
+
+    in_function = 1;
+    for (int i = 0; i < program->list.count; i++) {
+        AST *decl = program->list.items[i];
+        if (decl->type != AST_FUNC_DECL) continue;
+        begin_frame();
+        for (int p = 0; p < decl->func.params_count; p++)
+            add_local(decl->func.params[p].name);
+        resolve_stmt(decl->func.body);
+        decl->func.locals = max_slot;
+    }
+    in_function = 0;
+    frames.globals = global_count;
+
+    free(locals);
+    free(global_slot);
+    free(func_index);
+    free(func_decl);
+    global_slot = func_index = NULL;
+    func_decl = NULL;
+    locals = NULL;
+    local_count = local_cap = 0;
+    check_parallel(program);
+    return frames;
+}
@@ -0,0 +1,20 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+#include "parser.h"
+
+// Tamanhos dos frames calculados pelo resolve; o de cada funcao fica em
+// AST_FUNC_DECL (func.locals).
+typedef struct {
+    int globals;        // slots do vetor de globais
+    int main_locals;    // slots do frame do codigo de topo (locais de `for`)
+} Frames;
+
+// Resolve cada variavel para (depth, slot) em tempo de compilacao: preenche
+// AST.depth e o slot de IDENTIFIER/INPUT (var.slot) e VAR_DECL/ASSIGN
+// (stmt.slot). Cada chamada e ligada a sua funcao (list.index, a posicao da
+// declaracao entre as AST_FUNC_DECL do programa) e tem a aridade verificada.
+// Por fim verifica as regras dos parallel for (parallel.h). Usado pelo
+// interpretador e pelo compilador de bytecode.
+Frames resolve(AST *program);
+
+#endif
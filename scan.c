@@ -0,0 +1,218 @@
+#include "scan.h"
+#include <stdatomic.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// Classes de caracteres no locale "C", iguais a isspace/isalnum.
+static inline int is_space(unsigned char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+static inline int is_ident(unsigned char c) {
+    return (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a' ||
+           (unsigned char)(c - '0') <= 9 || c == '_';
+}
+
+static size_t scalar_skip_space(const char *s, size_t pos, size_t len) {
+    while (pos < len && is_space(s[pos])) pos++;
+    return pos;
+}
+
+static size_t scalar_find_newline(const char *s, size_t pos, size_t len) {
+    while (pos < len && s[pos] != '\n') pos++;
+    return pos;
+}
+
+static size_t scalar_skip_ident(const char *s, size_t pos, size_t len) {
+    while (pos < len && is_ident(s[pos])) pos++;
+    return pos;
+}
+
+static size_t scalar_find_quote(const char *s, size_t pos, size_t len) {
+    while (pos < len && s[pos] != '"' && s[pos] != '\\') pos++;
+    return pos;
+}
+
+#ifdef SCAN_X86
+
+// Comparacao sem sinal byte a byte: x <= lim  <=>  min(x, lim) == x.
+#define LE_EPU8(x, lim)   _mm_cmpeq_epi8(_mm_min_epu8((x), (lim)), (x))
+#define LE_EPU8_256(x, lim) _mm256_cmpeq_epi8(_mm256_min_epu8((x), (lim)), (x))
+
+static inline __m128i sse2_space_mask(__m128i v) {
+    __m128i ctrl = LE_EPU8(_mm_sub_epi8(v, _mm_set1_epi8('\t')), _mm_set1_epi8('\r' - '\t'));
+    return _mm_or_si128(ctrl, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+}
+
+static inline __m128i sse2_ident_mask(__m128i v) {
+    __m128i lower = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i alpha = LE_EPU8(lower, _mm_set1_epi8('z' - 'a'));
+    __m128i digit = LE_EPU8(_mm_sub_epi8(v, _mm_set1_epi8('0')), _mm_set1_epi8(9));
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(alpha, digit), under);
+}
+
+static size_t sse2_skip_space(const char *s, size_t pos, size_t len) {
+    // Espacos costumam vir em sequencias curtas; o primeiro byte decide.
+    if (pos >= len || !is_space(s[pos])) return pos;
+    while (pos + 16 <= len) {
+        unsigned m = ~_mm_movemask_epi8(sse2_space_mask(_mm_loadu_si128((const __m128i *)(s + pos)))) & 0xFFFF;
+        if (m) return pos + __builtin_ctz(m);
+        pos += 16;
+    }
+    return scalar_skip_space(s, pos, len);
+}
+
+static size_t sse2_find_newline(const char *s, size_t pos, size_t len) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    while (pos + 16 <= len) {
+        unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(s + pos)), nl));
+        if (m) return pos + __builtin_ctz(m);
+        pos += 16;
+    }
+    return scalar_find_newline(s, pos, len);
+}
+
+static size_t sse2_skip_ident(const char *s, size_t pos, size_t len) {
+    while (pos + 16 <= len) {
+        unsigned m = ~_mm_movemask_epi8(sse2_ident_mask(_mm_loadu_si128((const __m128i *)(s + pos)))) & 0xFFFF;
+        if (m) return pos + __builtin_ctz(m);
+        pos += 16;
+    }
+    return scalar_skip_ident(s, pos, len);
+}
+
+static size_t sse2_find_quote(const char *s, size_t pos, size_t len) {
+    const __m128i quote = _mm_set1_epi8('"'), slash = _mm_set1_epi8('\\');
+    while (pos + 16 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + pos));
+        unsigned m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)));
+        if (m) return pos + __builtin_ctz(m);
+        pos += 16;
+    }
+    return scalar_find_quote(s, pos, len);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i avx2_space_mask(__m256i v) {
+    __m256i ctrl = LE_EPU8_256(_mm256_sub_epi8(v, _mm256_set1_epi8('\t')), _mm256_set1_epi8('\r' - '\t'));
+    return _mm256_or_si256(ctrl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+}
+
+AVX2 static inline __m256i avx2_ident_mask(__m256i v) {
+    __m256i lower = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i alpha = LE_EPU8_256(lower, _mm256_set1_epi8('z' - 'a'));
+    __m256i digit = LE_EPU8_256(_mm256_sub_epi8(v, _mm256_set1_epi8('0')), _mm256_set1_epi8(9));
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(alpha, digit), under);
+}
+
+AVX2 static size_t avx2_skip_space(const char *s, size_t pos, size_t len) {
+    if (pos >= len || !is_space(s[pos])) return pos;
+    while (pos + 32 <= len) {
+        unsigned m = ~(unsigned)_mm256_movemask_epi8(avx2_space_mask(_mm256_loadu_si256((const __m256i *)(s + pos))));
+        if (m) return pos + __builtin_ctz(m);
+        pos += 32;
+    }
+    return sse2_skip_space(s, pos, len);
+}
+
+AVX2 static size_t avx2_find_newline(const char *s, size_t pos, size_t len) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    while (pos + 32 <= len) {
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(s + pos)), nl));
+        if (m) return pos + __builtin_ctz(m);
+        pos += 32;
+    }
+    return sse2_find_newline(s, pos, len);
+}
+
+AVX2 static size_t avx2_skip_ident(const char *s, size_t pos, size_t len) {
+    while (pos + 32 <= len) {
+        unsigned m = ~(unsigned)_mm256_movemask_epi8(avx2_ident_mask(_mm256_loadu_si256((const __m256i *)(s + pos))));
+        if (m) return pos + __builtin_ctz(m);
+        pos += 32;
+    }
+    return sse2_skip_ident(s, pos, len);
+}
+
+AVX2 static size_t avx2_find_quote(const char *s, size_t pos, size_t len) {
+    const __m256i quote = _mm256_set1_epi8('"'), slash = _mm256_set1_epi8('\\');
+    while (pos + 32 <= len) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + pos));
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, slash)));
+        if (m) return pos + __builtin_ctz(m);
+        pos += 32;
+    }
+    return sse2_find_quote(s, pos, len);
+}
+
+#endif
+
+_Thread_local Scanner scanner = { scalar_skip_space, scalar_find_newline, scalar_skip_ident, scalar_find_quote };
+// O modo vale para o processo todo (--scan e lido uma vez); cada thread
+// guarda as rotinas instaladas e refaz a escolha se o modo mudar.
+static atomic_int process_mode = SCAN_AUTO;
+static _Thread_local int installed = -1;
+
+int scan_supported(ScanMode mode) {
+    switch (mode) {
+        case SCAN_AUTO:
+        case SCAN_SCALAR: return 1;
+#ifdef SCAN_X86
+        case SCAN_SSE2: return __builtin_cpu_supports("sse2");
+        case SCAN_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return 0;
+    }
+}
+
+const char *scan_mode_name(ScanMode mode) {
+    switch (mode) {
+        case SCAN_SCALAR: return "scalar";
+        case SCAN_SSE2: return "sse2";
+        case SCAN_AVX2: return "avx2";
+        default: return "auto";
+    }
+}
+
+static ScanMode install(ScanMode mode) {
+    installed = mode;
+    if (mode == SCAN_AUTO) {
+        mode = SCAN_SCALAR;
+        if (scan_supported(SCAN_SSE2)) mode = SCAN_SSE2;
+        if (scan_supported(SCAN_AVX2)) mode = SCAN_AVX2;
+    }
+    if (!scan_supported(mode)) mode = SCAN_SCALAR;
+    switch (mode) {
+#ifdef SCAN_X86
+        case SCAN_SSE2:
+            scanner = (Scanner){ sse2_skip_space, sse2_find_newline, sse2_skip_ident, sse2_find_quote };
+            break;
+        case SCAN_AVX2:
+            scanner = (Scanner){ avx2_skip_space, avx2_find_newline, avx2_skip_ident, avx2_find_quote };
+            break;
+#endif
+        default:
+            scanner = (Scanner){ scalar_skip_space, scalar_find_newline, scalar_skip_ident, scalar_find_quote };
+            mode = SCAN_SCALAR;
+            break;
+    }
+    return mode;
+}
+
+// Fixa o modo de todas as threads (SCAN_AUTO = melhor disponivel), instala
+// as rotinas nesta e devolve o modo efetivamente usado.
+ScanMode scan_select(ScanMode mode) {
+    atomic_store_explicit(&process_mode, mode, memory_order_relaxed);
+    return install(mode);
+}
+
+void scan_init(void) {
+    int mode = atomic_load_explicit(&process_mode, memory_order_relaxed);
+    if (installed != mode) install(mode);
+}
@@ -0,0 +1,31 @@
+#ifndef SCAN_H
+#define SCAN_H
+#include <stddef.h>
+
+// Primitivas de varredura usadas pelo lexer. Cada funcao recebe o buffer, a
+// posicao inicial e o tamanho total, e devolve a primeira posicao que nao
+// pertence a classe procurada (ou `len`). Ha versoes escalar, SSE2 e AVX2;
+// a melhor suportada pela CPU e escolhida em tempo de execucao. scan_select
+// vale para todas as threads: cada uma instala o modo em scan_init.
+typedef enum {
+    SCAN_AUTO,
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2
+} ScanMode;
+
+typedef struct {
+    size_t (*skip_space)(const char *s, size_t pos, size_t len);     // espacos em branco
+    size_t (*find_newline)(const char *s, size_t pos, size_t len);   // fim de comentario
+    size_t (*skip_ident)(const char *s, size_t pos, size_t len);     // [A-Za-z0-9_]
+    size_t (*find_quote)(const char *s, size_t pos, size_t len);     // '"' ou '\\'
+} Scanner;
+
+extern _Thread_local Scanner scanner;
+
+ScanMode scan_select(ScanMode mode);
+void scan_init(void);
+int scan_supported(ScanMode mode);
+const char *scan_mode_name(ScanMode mode);
+
+#endif
@@ -0,0 +1,88 @@
+#include "source.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CHUNK_SIZE (64 * 1024)
+
+// Mapeia o arquivo sobre uma regiao anonima um pouco maior, de modo que
+// sempre exista ao menos um byte zerado apos o fim (o sentinela do lexer),
+// mesmo quando o tamanho e multiplo exato da pagina.
+static int map_file(Source *s, int fd, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t map_len = (size / page + 1) * page;
+    char *base = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return -1;
+    if (size > 0 && mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, map_len);
+        return -1;
+    }
+    s->data = base;
+    s->len = size;
+    s->map_len = map_len;
+    s->eof = 1;
+    return 0;
+}
+
+int source_open_file(Source *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && map_file(s, fd, (size_t)st.st_size) == 0) {
+        close(fd);
+        s->fd = -1;
+        return 0;
+    }
+    // Nao e um arquivo regular (fifo, dispositivo...): le em blocos.
+    source_open_stream(s, fd);
+    return 0;
+}
+
+void source_open_stream(Source *s, int fd) {
+    memset(s, 0, sizeof(*s));
+    s->fd = fd;
+    s->cap = CHUNK_SIZE;
+    s->data = malloc(s->cap + 1);
+    s->data[0] = '\0';
+    source_refill(s, 0);
+}
+
+// Descarta os primeiros `discard` bytes (ja consumidos pelo lexer) e le mais
+// um bloco. Devolve quantos bytes novos chegaram; 0 indica fim da entrada.
+size_t source_refill(Source *s, size_t discard) {
+    if (s->eof) return 0;
+    if (discard > 0) {
+        memmove(s->data, s->data + discard, s->len - discard);
+        s->len -= discard;
+    }
+    if (s->cap - s->len < CHUNK_SIZE) {
+        while (s->cap - s->len < CHUNK_SIZE) s->cap *= 2;
+        s->data = realloc(s->data, s->cap + 1);
+    }
+    ssize_t n;
+    do {
+        n = read(s->fd, s->data + s->len, s->cap - s->len);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        s->eof = 1;
+        n = 0;
+    }
+    s->len += (size_t)n;
+    s->data[s->len] = '\0';
+    return (size_t)n;
+}
+
+void source_close(Source *s) {
+    if (s->map_len) {
+        munmap(s->data, s->map_len);
+    } else {
+        free(s->data);
+        if (s->fd > STDERR_FILENO) close(s->fd);
+    }
+    memset(s, 0, sizeof(*s));
+}
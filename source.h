@@ -0,0 +1,22 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+#include <stddef.h>
+
+// Codigo fonte entregue ao lexer. Arquivos regulares sao mapeados com mmap e
+// varridos no lugar (sem copia); stdin e pipes sao lidos em blocos, sob
+// demanda do lexer. Em ambos os casos data[len] e sempre '\0'.
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;       // capacidade do buffer de streaming
+    size_t map_len;   // tamanho do mapeamento (0 se nao for mmap)
+    int fd;
+    int eof;
+} Source;
+
+int source_open_file(Source *s, const char *path);
+void source_open_stream(Source *s, int fd);
+size_t source_refill(Source *s, size_t discard);
+void source_close(Source *s);
+
+#endif
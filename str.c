@@ -0,0 +1,108 @@
+#include "str.h"
+#include <string.h>
+#include <pthread.h>
+
+// Strings de 1 byte: tabela fixa, iniciada em tempo de compilacao para que
+// threads diferentes (macslang.h) possam compartilha-la sem escrever nela.
+#define SMALL1(c) { STR_STATIC, 1, 1, small_chars[c] }
+#define SMALL4(c) SMALL1(c), SMALL1(c + 1), SMALL1(c + 2), SMALL1(c + 3)
+#define SMALL16(c) SMALL4(c), SMALL4(c + 4), SMALL4(c + 8), SMALL4(c + 12)
+#define SMALL64(c) SMALL16(c), SMALL16(c + 16), SMALL16(c + 32), SMALL16(c + 48)
+#define CHAR1(c) { (char)(c), 0 }
+#define CHAR4(c) CHAR1(c), CHAR1(c + 1), CHAR1(c + 2), CHAR1(c + 3)
+#define CHAR16(c) CHAR4(c), CHAR4(c + 4), CHAR4(c + 8), CHAR4(c + 12)
+#define CHAR64(c) CHAR16(c), CHAR16(c + 16), CHAR16(c + 32), CHAR16(c + 48)
+
+static Str empty = { STR_STATIC, 0, 0, "" };
+static char small_chars[256][2] = { CHAR64(0), CHAR64(64), CHAR64(128), CHAR64(192) };
+static Str small[256] = { SMALL64(0), SMALL64(64), SMALL64(128), SMALL64(192) };
+
+// Blocos curtos livres, encadeados pelo campo chars. A chave so existe para
+// o destrutor esvaziar a lista no fim da thread.
+static _Thread_local Str *cache;
+static _Thread_local int cached, registered;
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+static void cache_free(void *unused) {
+    (void)unused;
+    while (cache) {
+        Str *next = (Str*)cache->chars;
+        free(cache);
+        cache = next;
+    }
+    cached = 0;
+}
+
+static void cache_key_init(void) {
+    pthread_key_create(&cache_key, cache_free);
+}
+
+void str_free(Str *s) {
+    if (s->cap != STR_INLINE || cached == STR_CACHE_MAX) {
+        free(s);
+        return;
+    }
+    if (!registered) {
+        pthread_once(&cache_once, cache_key_init);
+        pthread_setspecific(cache_key, &cached);
+        registered = 1;
+    }
+    s->chars = (char*)cache;
+    cache = s;
+    cached++;
+}
+
+Str *str_alloc(int len) {
+    Str *s;
+    if (len <= STR_INLINE && cache) {
+        s = cache;
+        cache = (Str*)s->chars;
+        cached--;
+    } else {
+        s = malloc(sizeof(Str) + (len <= STR_INLINE ? STR_INLINE : len) + 1);
+    }
+    s->refs = 1;
+    s->len = len;
+    s->cap = len <= STR_INLINE ? STR_INLINE : len;
+    s->chars = (char*)(s + 1);
+    s->chars[len] = '\0';
+    return s;
+}
+
+Str *str_new(const char *s, int len) {
+    if (len == 0) return &empty;
+    if (len == 1) return &small[(unsigned char)s[0]];
+    Str *str = str_alloc(len);
+    memcpy(str->chars, s, len);
+    return str;
+}
+
+// Anexa `text` a `s`, consumindo a referencia. Se `s` nao e compartilhada
+// (refs == 1) o anexo e feito no lugar, crescendo a capacidade em progressao
+// geometrica; senao uma copia com folga e criada. Como ninguem mais enxerga
+// uma string com uma unica referencia, ela continua imutavel para os demais.
+Str *str_append(Str *s, const char *text, int len) {
+    if (len == 0) return s;
+    int need = s->len + len;
+    if (s->refs != 1 || need > s->cap) {
+        int cap = need < 16 ? 16 : need + need / 2;
+        Str *grown;
+        if (s->refs == 1) {
+            grown = realloc(s, sizeof(Str) + cap + 1);
+        } else {
+            grown = malloc(sizeof(Str) + cap + 1);
+            grown->refs = 1;
+            grown->len = s->len;
+            memcpy(grown + 1, s->chars, s->len);
+            str_release(s);
+        }
+        grown->cap = cap;
+        grown->chars = (char*)(grown + 1);
+        s = grown;
+    }
+    memcpy(s->chars + s->len, text, len);
+    s->len = need;
+    s->chars[need] = '\0';
+    return s;
+}
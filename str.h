@@ -0,0 +1,39 @@
+#ifndef STR_H
+#define STR_H
+#include <stdlib.h>
+
+// String imutavel com contagem de referencias. Copiar uma string em tempo de
+// execucao so incrementa `refs`; a memoria volta ao sistema quando a ultima
+// referencia e solta. Os caracteres de strings do heap ficam na mesma alocacao
+// do cabecalho; literais da AST e strings de ate 1 byte sao estaticas.
+// Strings curtas (ate STR_INLINE bytes) usam todas um bloco de mesmo tamanho,
+// com buffer inline de STR_INLINE bytes: blocos soltos voltam a uma lista da
+// thread (ate STR_CACHE_MAX) e sao reaproveitados sem malloc nem free, e anexos
+// que ainda cabem no buffer sao feitos no lugar. A lista e liberada quando a
+// thread termina.
+typedef struct {
+    int refs;       // STR_STATIC: nunca liberada
+    int len;
+    int cap;        // bytes reservados para chars (sem o NUL)
+    char *chars;    // terminada em NUL
+} Str;
+
+#define STR_STATIC (-1)
+#define STR_INLINE 15       // capacidade das strings curtas
+#define STR_CACHE_MAX 256   // blocos curtos guardados por thread
+
+Str *str_new(const char *s, int len);
+Str *str_alloc(int len);    // string do heap com `len` bytes a preencher
+Str *str_append(Str *s, const char *text, int len);
+void str_free(Str *s);      // devolve o bloco (refs ja chegou a 0)
+
+static inline Str *str_retain(Str *s) {
+    if (s->refs != STR_STATIC) s->refs++;
+    return s;
+}
+
+static inline void str_release(Str *s) {
+    if (s->refs != STR_STATIC && --s->refs == 0) str_free(s);
+}
+
+#endif
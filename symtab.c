@@ -0,0 +1,92 @@
+#include "symtab.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char *name;
+    int len;
+    unsigned hash;
+} Symbol;
+
+static _Thread_local Symbol *symbols = NULL;
+static _Thread_local int count = 0, capacity = 0;
+static _Thread_local int *slots = NULL;          // tabela aberta: indice em symbols + 1, ou 0 se vazio
+static _Thread_local unsigned slot_mask = 0;
+
+static unsigned hash_bytes(const char *s, int len) {
+    unsigned h = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void rehash(unsigned new_size) {
+    free(slots);
+    slots = calloc(new_size, sizeof(int));
+    slot_mask = new_size - 1;
+    for (int i = 0; i < count; i++) {
+        unsigned j = symbols[i].hash & slot_mask;
+        while (slots[j]) j = (j + 1) & slot_mask;
+        slots[j] = i + 1;
+    }
+}
+
+static int intern(const char *s, int len) {
+    unsigned h = hash_bytes(s, len);
+    unsigned j = h & slot_mask;
+    while (slots[j]) {
+        Symbol *sym = &symbols[slots[j] - 1];
+        if (sym->hash == h && sym->len == len && memcmp(sym->name, s, len) == 0)
+            return slots[j] - 1;
+        j = (j + 1) & slot_mask;
+    }
+    if (count == capacity) {
+        capacity = capacity ? capacity * 2 : 64;
+        symbols = realloc(symbols, sizeof(Symbol) * capacity);
+    }
+    Symbol *sym = &symbols[count];
+    sym->name = malloc(len + 1);
+    memcpy(sym->name, s, len);
+    sym->name[len] = '\0';
+    sym->len = len;
+    sym->hash = h;
+    slots[j] = ++count;
+    if ((unsigned)count * 2 > slot_mask) rehash((slot_mask + 1) * 2);
+    return count - 1;
+}
+
+static void init_table(void) {
+    rehash(128);
+    intern("int", 3);
+    intern("string", 6);
+    intern("bool", 4);
+    intern("task", 4);
+}
+
+int sym_intern(const char *s, int len) {
+    if (!slots) init_table();
+    return intern(s, len);
+}
+
+const char *sym_name(int id) {
+    if (id < 0 || id >= count) return "?";
+    return symbols[id].name;
+}
+
+int sym_count(void) {
+    if (!slots) init_table();
+    return count;
+}
+
+void sym_free(void) {
+    for (int i = 0; i < count; i++)
+        free(symbols[i].name);
+    free(symbols);
+    free(slots);
+    symbols = NULL;
+    slots = NULL;
+    count = capacity = 0;
+    slot_mask = 0;
+}
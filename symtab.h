@@ -0,0 +1,19 @@
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+// Tabela global de simbolos: cada identificador distinto recebe um id denso
+// (0, 1, 2, ...), de modo que o parser e o interpretador comparam inteiros.
+enum {
+    SYM_INT,
+    SYM_STRING,
+    SYM_BOOL,
+    SYM_TASK,
+    SYM_PREDEFINED_COUNT
+};
+
+int sym_intern(const char *s, int len);
+const char *sym_name(int id);
+int sym_count(void);
+void sym_free(void);
+
+#endif
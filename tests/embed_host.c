@@ -0,0 +1,147 @@
+// Programa hospedeiro de exemplo para a API de macslang.h: carrega um script,
+// chama suas funcoes de varias threads e confere os erros de scripts
+// invalidos. Cada thread carrega e usa o seu proprio contexto; um contexto
+// compartilhado passa de thread em thread, uma de cada vez (sob um mutex).
+// Sai com 1 se alguma verificacao falhou. Rodado por tests/run.sh, tambem
+// com -fsanitize=address,undefined e -fsanitize=thread.
+
+#include "../macslang.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREADS 4
+#define ROUNDS 200
+
+static const char script[] =
+    "var greeting: string = \"Hello, \";\n"
+    "var calls: int = 0;\n"
+    "print(\"loaded\");\n"
+    "func fib(n: int): int {\n"
+    "    if (n < 2) {\n"
+    "        return n;\n"
+    "    }\n"
+    "    return fib(n - 1) + fib(n - 2);\n"
+    "}\n"
+    "func greet(name: string): string {\n"
+    "    calls = calls + 1;\n"
+    "    return greeting + name + \" #\" + calls;\n"
+    "}\n"
+    "func even(n: int): bool {\n"
+    "    return n % 2 == 0;\n"
+    "}\n";
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static MacsContext *shared;
+static int shared_calls;
+static int failures;
+
+static void check(int ok, const char *what, int thread) {
+    if (ok) return;
+    pthread_mutex_lock(&lock);
+    fprintf(stderr, "FAIL (thread %d): %s\n", thread, what);
+    failures++;
+    pthread_mutex_unlock(&lock);
+}
+
+static int fib(int n) {
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+// Chamadas num contexto; `calls` e quantas vezes greet ja rodou nele.
+static void exercise(MacsContext *ctx, int id, int round, int calls) {
+    MacsValue arg = macs_int(10 + round % 8), result;
+    check(macs_call(ctx, "fib", &arg, 1, &result) == 0 && result.type == MACS_INT &&
+          result.i == fib(10 + round % 8), "fib", id);
+
+    char name[32], expected[64];
+    int len = snprintf(name, sizeof(name), "t%d", id);
+    snprintf(expected, sizeof(expected), "Hello, t%d #%d", id, calls + 1);
+    arg = macs_string(name, len);
+    check(macs_call(ctx, "greet", &arg, 1, &result) == 0 && result.type == MACS_STRING &&
+          result.len == (int)strlen(expected) && memcmp(result.s, expected, result.len) == 0, "greet", id);
+
+    arg = macs_int(round);
+    check(macs_call(ctx, "even", &arg, 1, &result) == 0 && result.type == MACS_BOOL &&
+          result.i == (round % 2 == 0), "even", id);
+
+    // Erros de chamada voltam ao hospedeiro sem afetar o contexto.
+    check(macs_call(ctx, "missing", NULL, 0, &result) == -1 &&
+          strstr(macs_error(ctx), "Undefined function") != NULL, "missing function", id);
+    arg = macs_string("x", 1);
+    check(macs_call(ctx, "fib", &arg, 1, &result) == -1 && strstr(macs_error(ctx), "must be int") != NULL,
+          "argument type", id);
+    check(macs_call(ctx, "fib", NULL, 0, &result) == -1 && strstr(macs_error(ctx), "expects 1") != NULL,
+          "arity", id);
+}
+
+static void *worker(void *arg) {
+    int id = (int)(size_t)arg;
+    MacsContext *ctx = macs_new();
+    macs_set_output(ctx, MACS_CAPTURE);
+    check(macs_load(ctx, script, (int)strlen(script)) == 0, "load", id);
+    int len;
+    const char *out = macs_output(ctx, &len);
+    check(len == 7 && memcmp(out, "loaded\n", 7) == 0, "top-level output", id);
+
+    for (int round = 0; round < ROUNDS; round++) {
+        exercise(ctx, id, round, round);
+        pthread_mutex_lock(&lock);
+        exercise(shared, id, round, shared_calls++);
+        pthread_mutex_unlock(&lock);
+    }
+    macs_free(ctx);
+    return NULL;
+}
+
+// Scripts invalidos: a carga falha com a mensagem em macs_error e o processo
+// continua.
+static void bad_scripts(void) {
+    static const struct { const char *source, *error; } cases[] = {
+        { "var x: int = ;\n", "Syntax error" },
+        { "var x: int = \"text\";\n", "Type error" },
+        { "print(y);\n", "undefined variable y" },
+        { "func f(n: int): int {\n    return n;\n}\nprint(f(1, 2));\n", "Type error" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        MacsContext *ctx = macs_new();
+        macs_set_output(ctx, MACS_CAPTURE);
+        int status = macs_load(ctx, cases[i].source, (int)strlen(cases[i].source));
+        if (status != -1 || !strstr(macs_error(ctx), cases[i].error)) {
+            fprintf(stderr, "FAIL: script %d: status %d, error \"%s\"\n", (int)i, status, macs_error(ctx));
+            failures++;
+        }
+        MacsValue result;
+        if (macs_call(ctx, "f", NULL, 0, &result) != -1) {
+            fprintf(stderr, "FAIL: script %d: call after failed load\n", (int)i);
+            failures++;
+        }
+        macs_free(ctx);
+    }
+}
+
+int main(void) {
+    bad_scripts();
+
+    shared = macs_new();
+    macs_set_output(shared, MACS_CAPTURE);
+    if (macs_load(shared, script, (int)strlen(script)) != 0) {
+        fprintf(stderr, "FAIL: shared load: %s", macs_error(shared));
+        return 1;
+    }
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) pthread_create(&threads[i], NULL, worker, (void*)(size_t)i);
+    for (int i = 0; i < THREADS; i++) pthread_join(threads[i], NULL);
+    macs_free(shared);
+
+    // Uma falha depois das threads: o estado de erro de uma carga nao vaza.
+    bad_scripts();
+
+    if (failures) {
+        fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    printf("embed: %d threads x %d rounds OK\n", THREADS, ROUNDS);
+    return 0;
+}
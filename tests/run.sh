@@ -0,0 +1,190 @@
+#!/bin/sh
+# Testes de ponta a ponta: compila o interpretador a partir das fontes e roda
+# cada programa com varias combinacoes de motor e opcoes, exigindo a mesma
+# saida da execucao padrao. Os programas de tests/programs tambem precisam
+# bater com o .out ao lado; os de Exemplos leem stdin de tests/inputs. Os que
+# usam parallel for ou spawn rodam tambem com --threads 1, 2, 3, 4 e 8. Todos
+# sao ainda compilados com --build (com $CC), e o binario precisa dar a
+# mesma saida do interpretador, ou a do .build.out quando as diferencas sao
+# conhecidas (funcao que termina sem return devolve o valor zero do tipo).
+# Por fim, os programas de tests/programs com parallel for ou spawn rodam em
+# 4 threads num interpretador compilado com TSan, e o hospedeiro de exemplo
+# (tests/embed_host.c) e compilado com a biblioteca e rodado normalmente, com
+# ASan/UBSan e com TSan.
+#
+#     tests/run.sh              # usa $CC (padrao: cc)
+#     MACSLANG=./macslang tests/run.sh
+#
+# Sai com 1 se algum teste falhou.
+
+cd "$(dirname "$0")/.." || exit 1
+CC=${CC:-cc}
+work=$(mktemp -d "${TMPDIR:-/tmp}/macslang-tests.XXXXXX") || exit 1
+trap 'rm -rf "$work"' EXIT INT TERM
+# Cache de programas proprio: a segunda execucao padrao le o .macslangc.
+XDG_CACHE_HOME=$work/cache
+export XDG_CACHE_HOME
+
+failed=0
+passed=0
+
+fail() {
+    echo "FAIL: $*"
+    failed=$((failed + 1))
+}
+
+if [ -z "${MACSLANG:-}" ]; then
+    MACSLANG=$work/macslang
+    if ! $CC -O2 ./*.c -pthread -o "$MACSLANG" 2>"$work/build.log"; then
+        cat "$work/build.log"
+        echo "FAIL: could not build macslang"
+        exit 1
+    fi
+fi
+
+# Opcoes comparadas com a execucao padrao (uma combinacao por linha).
+FLAGS='--no-cache
+--engine=vm
+--no-opt
+--no-quicken
+--no-memo
+--jit-threshold=1
+--engine=vm --no-opt
+--engine=vm --jit-threshold=1
+--no-opt --no-quicken'
+
+# run NOME ENTRADA PROGRAMA [OPCOES...]: saida em $work/NOME e status de
+# saida em $work/NOME.status.
+run() {
+    name=$1 input=$2 prog=$3
+    shift 3
+    "$MACSLANG" "$@" "$prog" <"$input" >"$work/$name" 2>&1
+    echo $? >"$work/$name.status"
+}
+
+# same A B: mesma saida e mesmo status; a diferenca fica em $work/diff.
+same() {
+    diff "$work/$1" "$work/$2" >"$work/diff" && cmp -s "$work/$1.status" "$work/$2.status"
+}
+
+# check PROGRAMA ENTRADA [ESPERADO]
+check() {
+    prog=$1 input=$2 expected=${3:-}
+    ok=1
+    run ref "$input" "$prog"
+    if [ -n "$expected" ]; then
+        cp "$expected" "$work/expected"
+        echo 0 >"$work/expected.status"
+        if ! same expected ref; then
+            fail "$prog: output differs from $expected"
+            head -n 10 "$work/diff"
+            ok=0
+        fi
+    fi
+    run cached "$input" "$prog"
+    if ! same ref cached; then
+        fail "$prog: output differs when loaded from the cache"
+        ok=0
+    fi
+    # Um here-document, e nao um pipe, para o laco rodar neste shell.
+    while IFS= read -r flags; do
+        # shellcheck disable=SC2086
+        run out "$input" "$prog" $flags
+        if ! same ref out; then
+            fail "$prog $flags"
+            head -n 10 "$work/diff"
+            ok=0
+        fi
+    done <<EOF2
+$FLAGS
+EOF2
+
+    # Com parallel for ou spawn, o resultado nao pode depender das threads.
+    if grep -q -e 'parallel for' -e 'spawn' "$prog"; then
+        for threads in 1 2 3 4 8; do
+            run out "$input" "$prog" --threads $threads
+            if ! same ref out; then
+                fail "$prog --threads $threads"
+                head -n 10 "$work/diff"
+                ok=0
+            fi
+        done
+    fi
+
+    # Binario nativo: o --build usa $CC, como o interpretador.
+    native=${expected%.out}.build.out
+    if ! "$MACSLANG" --build="$work/native" "$prog" >"$work/build.log" 2>&1; then
+        fail "$prog: --build failed"
+        head -n 10 "$work/build.log"
+        ok=0
+    else
+        "$work/native" <"$input" >"$work/out" 2>&1
+        echo $? >"$work/out.status"
+        if [ -n "$expected" ] && [ -f "$native" ]; then
+            cp "$native" "$work/expected"
+            echo 0 >"$work/expected.status"
+            same expected out
+        else
+            same ref out
+        fi || {
+            fail "$prog: --build binary differs"
+            head -n 10 "$work/diff"
+            ok=0
+        }
+    fi
+    [ $ok -eq 1 ] && passed=$((passed + 1))
+}
+
+for prog in Exemplos/*.macslang; do
+    input=tests/inputs/$(basename "$prog" .macslang).in
+    [ -f "$input" ] || input=/dev/null
+    check "$prog" "$input"
+done
+
+for prog in tests/programs/*.macslang; do
+    check "$prog" /dev/null "${prog%.macslang}.out"
+done
+
+# Tarefas e pedacos de parallel for sob TSan (que sai com erro se acusar
+# uma corrida).
+if $CC -O1 -g -fsanitize=thread ./*.c -pthread -o "$work/macslang-tsan" 2>"$work/build.log"; then
+    for prog in $(grep -l -e 'parallel for' -e 'spawn' tests/programs/*.macslang); do
+        "$work/macslang-tsan" --no-cache --threads 4 "$prog" </dev/null >"$work/out" 2>&1
+        echo $? >"$work/out.status"
+        cp "${prog%.macslang}.out" "$work/expected"
+        echo 0 >"$work/expected.status"
+        if same expected out; then
+            passed=$((passed + 1))
+        else
+            fail "$prog under TSan"
+            head -n 20 "$work/diff"
+        fi
+    done
+else
+    echo "skip: TSan interpreter (-fsanitize=thread not supported by $CC)"
+fi
+
+# Hospedeiro embutido; as variantes com sanitizers sao puladas se $CC nao as
+# suporta.
+lib=$(ls ./*.c | grep -v '/main\.c$')
+for san in "" "-fsanitize=address,undefined -fno-sanitize-recover=all" "-fsanitize=thread"; do
+    # shellcheck disable=SC2086
+    if ! $CC -O1 -g $san tests/embed_host.c $lib -pthread -o "$work/embed" 2>"$work/build.log"; then
+        if [ -z "$san" ]; then
+            fail "tests/embed_host.c: build failed"
+            head -n 20 "$work/build.log"
+        else
+            echo "skip: tests/embed_host.c $san (not supported by $CC)"
+        fi
+        continue
+    fi
+    if "$work/embed" >"$work/out" 2>&1; then
+        passed=$((passed + 1))
+    else
+        fail "tests/embed_host.c $san"
+        head -n 20 "$work/out"
+    fi
+done
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,332 @@
+#include "typecheck.h"
+#include "errors.h"
+#include "symtab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+// Regras:
+//   +            int + int -> int; com uma string de qualquer lado -> string
+//   - * / %      int, int -> int
+//   < <= > >=    int, int -> bool
+//   == !=        operandos do mesmo tipo -> bool
+//   condicoes de if/while/for devem ser bool; declaracoes, atribuicoes,
+//   argumentos e returns devem ter exatamente o tipo declarado.
+//   spawn f(...)  f devolve int -> task; await task -> int. Um task nao entra
+//                 em operadores, print nem input.
+// O escopo e o mesmo da VM: uma funcao enxerga seus parametros e locais e as
+// globais (declaradas no topo, fora de `for`); apenas funcoes e `for` abrem
+// escopo.
+
+typedef struct {
+    int sym;
+    TypeKind type;
+} Binding;
+
+static _Thread_local Binding *env;
+static _Thread_local int env_count, env_cap;
+static _Thread_local int scope_start;
+static _Thread_local TypeKind *global_type;   // sym -> tipo da global, TYPE_NONE se nao houver
+static _Thread_local AST **func_decl;         // sym -> declaracao da funcao
+static _Thread_local AST *current_func;
+static _Thread_local int errors;
+
+static const char *type_name(TypeKind t) {
+    switch (t) {
+        case TYPE_INT: return "int";
+        case TYPE_STRING: return "string";
+        case TYPE_BOOL: return "bool";
+        case TYPE_TASK: return "task";
+        default: return "none";
+    }
+}
+
+static TypeKind type_from_sym(int sym) {
+    if (sym == SYM_INT) return TYPE_INT;
+    if (sym == SYM_STRING) return TYPE_STRING;
+    if (sym == SYM_BOOL) return TYPE_BOOL;
+    if (sym == SYM_TASK) return TYPE_TASK;
+    return TYPE_NONE;
+}
+
+static void type_error(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    error_printf("Type error: ");
+    error_vprintf(fmt, ap);
+    if (current_func) error_printf(" (in function %s)", sym_name(current_func->sym));
+    error_printf("\n");
+    va_end(ap);
+    errors++;
+}
+
+static TypeKind lookup(int sym) {
+    for (int i = env_count - 1; i >= 0; i--)
+        if (env[i].sym == sym) return env[i].type;
+    return global_type[sym];
+}
+
+static void declare(int sym, TypeKind type) {
+    for (int i = scope_start; i < env_count; i++) {
+        if (env[i].sym == sym) {
+            if (env[i].type != type)
+                type_error("variable %s redeclared as %s (was %s)", sym_name(sym), type_name(type), type_name(env[i].type));
+            return;
+        }
+    }
+    if (env_count == env_cap) {
+        env_cap = env_cap ? env_cap * 2 : 32;
+        env = realloc(env, sizeof(Binding) * env_cap);
+    }
+    env[env_count].sym = sym;
+    env[env_count].type = type;
+    env_count++;
+}
+
+// Globais: declaracoes no topo do programa, inclusive dentro de blocos de
+// if/while (que nao abrem escopo), mas nao dentro de `for` ou de funcoes.
+static void collect_globals(AST *ast) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                collect_globals(ast->list.items[i]);
+            break;
+        case AST_VAR_DECL: {
+            TypeKind t = type_from_sym(ast->stmt.type_sym);
+            if (global_type[ast->sym] != TYPE_NONE && global_type[ast->sym] != t)
+                type_error("variable %s redeclared as %s (was %s)", sym_name(ast->sym), type_name(t), type_name(global_type[ast->sym]));
+            global_type[ast->sym] = t;
+            break;
+        }
+        case AST_IF:
+            collect_globals(ast->branch.then_body);
+            collect_globals(ast->branch.else_body);
+            break;
+        case AST_WHILE:
+            collect_globals(ast->loop.body);
+            break;
+        default:
+            break;
+    }
+}
+
+static TypeKind check_expr(AST *ast);
+
+static TypeKind check_call(AST *ast) {
+    AST *decl = func_decl[ast->sym];
+    if (!decl) {
+        type_error("undefined function %s", sym_name(ast->sym));
+        for (int i = 0; i < ast->list.count; i++) check_expr(ast->list.items[i]);
+        return TYPE_NONE;
+    }
+    if (ast->list.count != decl->func.params_count)
+        type_error("function %s expects %d arguments, got %d", sym_name(ast->sym), decl->func.params_count, ast->list.count);
+    for (int i = 0; i < ast->list.count; i++) {
+        TypeKind t = check_expr(ast->list.items[i]);
+        if (i >= decl->func.params_count) continue;
+        TypeKind expected = type_from_sym(decl->func.params[i].type);
+        if (t != TYPE_NONE && t != expected)
+            type_error("argument %d of %s must be %s, got %s", i + 1, sym_name(ast->sym), type_name(expected), type_name(t));
+    }
+    return type_from_sym(decl->func.type_sym);
+}
+
+static TypeKind check_binop(AST *ast) {
+    TypeKind l = check_expr(ast->bin.left);
+    TypeKind r = check_expr(ast->bin.right);
+    if (l == TYPE_NONE || r == TYPE_NONE) return TYPE_NONE; // erro ja reportado
+    switch (ast->op) {
+        case OP_ADD:
+            if ((l == TYPE_STRING || r == TYPE_STRING) && l != TYPE_TASK && r != TYPE_TASK) return TYPE_STRING;
+            /* fallthrough */
+        case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+            if (l == TYPE_INT && r == TYPE_INT) return TYPE_INT;
+            break;
+        case OP_LT: case OP_LTE: case OP_GT: case OP_GTE:
+            if (l == TYPE_INT && r == TYPE_INT) return TYPE_BOOL;
+            break;
+        case OP_EQ: case OP_NEQ:
+            if (l == r && l != TYPE_TASK) return TYPE_BOOL;
+            break;
+    }
+    static const char *names[] = { "+", "-", "*", "/", "%", "==", "!=", "<", "<=", ">", ">=" };
+    type_error("operator %s cannot be applied to %s and %s", names[ast->op], type_name(l), type_name(r));
+    return TYPE_NONE;
+}
+
+static TypeKind check_expr(AST *ast) {
+    TypeKind t = TYPE_NONE;
+    switch (ast->type) {
+        case AST_LITERAL:
+            return ast->vtype;
+        case AST_IDENTIFIER:
+            t = lookup(ast->sym);
+            if (t == TYPE_NONE) type_error("undefined variable %s", sym_name(ast->sym));
+            break;
+        case AST_BINOP:
+            t = check_binop(ast);
+            break;
+        case AST_FUNC_CALL:
+            t = check_call(ast);
+            break;
+        case AST_SPAWN:
+            t = check_call(ast);
+            if (t != TYPE_NONE && t != TYPE_INT)
+                type_error("spawn needs a function returning int, %s returns %s", sym_name(ast->sym), type_name(t));
+            t = TYPE_TASK;
+            break;
+        case AST_AWAIT:
+            t = check_expr(ast->stmt.expr);
+            if (t != TYPE_NONE && t != TYPE_TASK)
+                type_error("await needs a task, got %s", type_name(t));
+            t = TYPE_INT;
+            break;
+        default:
+            break;
+    }
+    ast->vtype = t;
+    return t;
+}
+
+static void check_cond(AST *cond, const char *what) {
+    TypeKind t = check_expr(cond);
+    if (t != TYPE_NONE && t != TYPE_BOOL)
+        type_error("%s condition must be bool, got %s", what, type_name(t));
+}
+
+static void check_stmt(AST *ast) {
+    if (!ast) return;
+    switch (ast->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < ast->list.count; i++)
+                check_stmt(ast->list.items[i]);
+            break;
+        case AST_VAR_DECL: {
+            TypeKind declared = type_from_sym(ast->stmt.type_sym);
+            ast->vtype = declared;
+            if (ast->stmt.expr) {
+                TypeKind t = check_expr(ast->stmt.expr);
+                if (t != TYPE_NONE && t != declared)
+                    type_error("cannot initialize %s variable %s with %s", type_name(declared), sym_name(ast->sym), type_name(t));
+            }
+            // No topo (fora de `for`) a variavel ja e uma global conhecida.
+            if (current_func || scope_start > 0 || env_count > 0)
+                declare(ast->sym, declared);
+            break;
+        }
+        case AST_ASSIGN: {
+            TypeKind t = check_expr(ast->stmt.expr);
+            TypeKind declared = lookup(ast->sym);
+            ast->vtype = declared;
+            if (declared == TYPE_NONE)
+                type_error("undefined variable %s", sym_name(ast->sym));
+            else if (t != TYPE_NONE && t != declared)
+                type_error("cannot assign %s to %s variable %s", type_name(t), type_name(declared), sym_name(ast->sym));
+            break;
+        }
+        case AST_PRINT:
+            if (check_expr(ast->stmt.expr) == TYPE_TASK)
+                type_error("cannot print a task (use await)");
+            break;
+        case AST_INPUT:
+            ast->vtype = lookup(ast->sym);
+            if (ast->vtype == TYPE_NONE)
+                type_error("undefined variable %s", sym_name(ast->sym));
+            else if (ast->vtype == TYPE_TASK)
+                type_error("cannot read input into task variable %s", sym_name(ast->sym));
+            break;
+        case AST_RETURN: {
+            TypeKind t = check_expr(ast->stmt.expr);
+            if (current_func) {
+                TypeKind expected = type_from_sym(current_func->func.type_sym);
+                if (t != TYPE_NONE && t != expected)
+                    type_error("%s must return %s, got %s", sym_name(current_func->sym), type_name(expected), type_name(t));
+            }
+            break;
+        }
+        case AST_FUNC_CALL:
+            check_call(ast);
+            break;
+        case AST_IF:
+            check_cond(ast->branch.cond, "if");
+            check_stmt(ast->branch.then_body);
+            check_stmt(ast->branch.else_body);
+            break;
+        case AST_WHILE:
+            check_cond(ast->loop.cond, "while");
+            check_stmt(ast->loop.body);
+            break;
+        case AST_FOR: {
+            int saved_start = scope_start, saved_count = env_count;
+            scope_start = env_count;
+            // Marca o escopo do for mesmo vazio, para que o init seja local.
+            declare(-1, TYPE_NONE);
+            check_stmt(ast->loop.init);
+            check_cond(ast->loop.cond, "for");
+            check_stmt(ast->loop.incr);
+            check_stmt(ast->loop.body);
+            scope_start = saved_start;
+            env_count = saved_count;
+            break;
+        }
+        case AST_PARALLEL_FOR:
+            if (ast->par.reduce) {
+                TypeKind t = check_expr(ast->par.reduce);
+                if (t != TYPE_INT && t != TYPE_NONE)
+                    type_error("reduce sum variable %s must be int, got %s", sym_name(ast->par.reduce->sym), type_name(t));
+            }
+            check_stmt(ast->par.loop);
+            break;
+        default:
+            break;
+    }
+}
+
+static void check_function(AST *decl) {
+    current_func = decl;
+    env_count = scope_start = 0;
+    if (type_from_sym(decl->func.type_sym) == TYPE_NONE)
+        type_error("unknown return type %s", sym_name(decl->func.type_sym));
+    for (int i = 0; i < decl->func.params_count; i++) {
+        TypeKind t = type_from_sym(decl->func.params[i].type);
+        if (t == TYPE_NONE)
+            type_error("unknown type %s for parameter %s", sym_name(decl->func.params[i].type), sym_name(decl->func.params[i].name));
+        declare(decl->func.params[i].name, t);
+    }
+    // Sentinela: mesmo sem parametros o corpo nao declara globais.
+    declare(-1, TYPE_NONE);
+    check_stmt(decl->func.body);
+    current_func = NULL;
+}
+
+int typecheck(AST *program) {
+    int nsyms = sym_count();
+    global_type = calloc(nsyms, sizeof(TypeKind));
+    func_decl = calloc(nsyms, sizeof(AST*));
+    errors = 0;
+    env_count = scope_start = 0;
+    current_func = NULL;
+
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type == AST_FUNC_DECL) func_decl[stmt->sym] = stmt;
+    }
+    collect_globals(program);
+
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type != AST_FUNC_DECL) check_stmt(stmt);
+    }
+    for (int i = 0; i < program->list.count; i++) {
+        AST *stmt = program->list.items[i];
+        if (stmt->type == AST_FUNC_DECL) check_function(stmt);
+    }
+
+    free(env);
+    free(global_type);
+    free(func_decl);
+    env = NULL;
+    env_count = env_cap = 0;
+    return errors;
+}
@@ -0,0 +1,9 @@
+#ifndef TYPECHECK_H
+#define TYPECHECK_H
+#include "parser.h"
+
+// Verificacao de tipos antes da execucao. Anota cada expressao com seu tipo
+// (AST.vtype) e reporta os erros encontrados; devolve o numero de erros.
+int typecheck(AST *program);
+
+#endif
@@ -0,0 +1,165 @@
+#include "value.h"
+#include "symtab.h"
+#include "io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Value value_string(const char *s) {
+    if (!s) s = "";
+    return value_str(str_new(s, (int)strlen(s)));
+}
+
+int is_truthy(Value v) {
+    if (v.type == VAL_BOOL) return v.bool_val;
+    if (v.type == VAL_INT) return v.int_val != 0;
+    if (v.type == VAL_STRING) return v.str->len > 0;
+    return 0;
+}
+
+// Ajusta o valor ao tipo declarado de uma variavel (int, string, bool ou
+// task; sem tarefas em paralelo, um task guarda o int do resultado).
+Value value_coerce(Value v, int type_sym) {
+    if (type_sym == SYM_INT && v.type != VAL_INT) { value_free(v); v = value_int(0); }
+    if (type_sym == SYM_STRING && v.type != VAL_STRING) { value_free(v); v = value_string(""); }
+    if (type_sym == SYM_BOOL && v.type != VAL_BOOL) { value_free(v); v = value_bool(0); }
+    if (type_sym == SYM_TASK && v.type != VAL_TASK && v.type != VAL_INT) { value_free(v); v = value_int(0); }
+    return v;
+}
+
+// Escreve `n` em decimal terminando em `end`; devolve o primeiro caractere.
+static char *format_int(int n, char *end) {
+    unsigned int u = n < 0 ? 0u - (unsigned int)n : (unsigned int)n;
+    char *p = end;
+    do {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (n < 0) *--p = '-';
+    return p;
+}
+
+// Texto de um operando da concatenacao; `tmp` guarda ints formatados.
+const char *value_text(Value v, char *tmp, int *len) {
+    switch (v.type) {
+        case VAL_STRING: *len = v.str->len; return v.str->chars;
+        case VAL_INT: {
+            char *end = tmp + VALUE_TEXT_MAX;
+            char *p = format_int(v.int_val, end);
+            *len = (int)(end - p);
+            return p;
+        }
+        case VAL_BOOL: *len = v.bool_val ? 4 : 5; return v.bool_val ? "true" : "false";
+        default: *len = 0; return "";
+    }
+}
+
+// Aplica um operador binario; consome os dois operandos.
+Value value_binop(BinOp op, Value left, Value right) {
+    if ((op == OP_EQ || op == OP_NEQ) && left.type == VAL_STRING && right.type == VAL_STRING) {
+        int eq = left.str == right.str ||
+                 (left.str->len == right.str->len && memcmp(left.str->chars, right.str->chars, left.str->len) == 0);
+        value_free(left);
+        value_free(right);
+        return value_bool(op == OP_EQ ? eq : !eq);
+    }
+    if ((left.type == VAL_STRING) || (right.type == VAL_STRING)) {
+        char ltmp[VALUE_TEXT_MAX], rtmp[VALUE_TEXT_MAX];
+        int llen, rlen;
+        const char *lstr = value_text(left, ltmp, &llen);
+        const char *rstr = value_text(right, rtmp, &rlen);
+        Str *s = str_alloc(llen + rlen);
+        memcpy(s->chars, lstr, llen);
+        memcpy(s->chars + llen, rstr, rlen);
+        value_free(left);
+        value_free(right);
+        return value_str(s);
+    }
+    // Bools so aparecem aqui em == e != (o verificador de tipos garante).
+    int l = (left.type == VAL_INT || left.type == VAL_BOOL) ? left.int_val : 0;
+    int r = (right.type == VAL_INT || right.type == VAL_BOOL) ? right.int_val : 0;
+    int res = 0;
+    switch (op) {
+        case OP_ADD: res = int_add(l, r); break;
+        case OP_SUB: res = int_sub(l, r); break;
+        case OP_MUL: res = int_mul(l, r); break;
+        case OP_DIV: res = int_div(l, r); break;
+        case OP_MOD: res = int_mod(l, r); break;
+        case OP_LT: return value_bool(l < r);
+        case OP_LTE: return value_bool(l <= r);
+        case OP_GT: return value_bool(l > r);
+        case OP_GTE: return value_bool(l >= r);
+        case OP_EQ: return value_bool(l == r);
+        case OP_NEQ: return value_bool(l != r);
+    }
+    return value_int(res);
+}
+
+// `x = x + part` com x string: anexa no lugar quando possivel; consome `part`.
+void value_append(Value *target, Value part) {
+    if (target->type != VAL_STRING) {
+        *target = value_binop(OP_ADD, *target, part);
+        return;
+    }
+    char tmp[VALUE_TEXT_MAX];
+    int len;
+    const char *text = value_text(part, tmp, &len);
+    target->str = str_append(target->str, text, len);
+    value_free(part);
+}
+
+// Concatena os n valores numa unica alocacao; consome todos.
+Value value_concat(Value *parts, int n) {
+    char tmp[VALUE_TEXT_MAX];
+    int total = 0, len;
+    for (int i = 0; i < n; i++) {
+        value_text(parts[i], tmp, &len);
+        total += len;
+    }
+    Str *s = str_alloc(total);
+    char *out = s->chars;
+    for (int i = 0; i < n; i++) {
+        const char *text = value_text(parts[i], tmp, &len);
+        memcpy(out, text, len);
+        out += len;
+        value_free(parts[i]);
+    }
+    return value_str(s);
+}
+
+// Imprime o valor seguido de nova linha; consome `v`.
+void value_print(Value v) {
+    if (v.type == VAL_NONE) return;
+    value_print_parts(&v, 1);
+}
+
+// print de uma concatenacao: escreve as partes direto na saida, sem montar a
+// string; consome todas.
+void value_print_parts(Value *parts, int n) {
+    char tmp[VALUE_TEXT_MAX];
+    int len;
+    for (int i = 0; i < n; i++) {
+        const char *text = value_text(parts[i], tmp, &len);
+        io_write(text, len);
+        value_free(parts[i]);
+    }
+    io_write("\n", 1);
+}
+
+// Le de stdin conforme o tipo atual da variavel.
+// A saida pendente e descarregada antes, para que prompts aparecam.
+void value_input(Value *v) {
+    io_flush();
+    if (v->type == VAL_INT) {
+        io_read_int(&v->int_val);
+    } else if (v->type == VAL_STRING) {
+        int len;
+        const char *line = io_read_line(&len);
+        str_release(v->str);
+        v->str = str_new(line, len);
+    } else if (v->type == VAL_BOOL) {
+        int tmp;
+        io_read_int(&tmp);
+        v->bool_val = (tmp != 0);
+    }
+}
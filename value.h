@@ -0,0 +1,112 @@
+#ifndef VALUE_H
+#define VALUE_H
+#include "parser.h"
+#include "str.h"
+
+typedef enum {
+    VAL_INT,
+    VAL_STRING,
+    VAL_BOOL,
+    VAL_NONE,
+    VAL_TASK
+} ValueType;
+
+// Tarefa de spawn em andamento (interpreter.c), com contagem atomica de
+// referencias: o handle pode passar de uma thread a outra.
+typedef struct Handle Handle;
+void handle_retain(Handle *h);
+void handle_release(Handle *h);
+
+typedef struct {
+    ValueType type;
+    union {
+        int int_val;
+        Str *str;           // uma referencia, solta por value_free
+        int bool_val;
+        Handle *task;       // idem
+    };
+} Value;
+
+// Operacoes sobre valores compartilhadas pelos motores de execucao
+// (interpretador de arvore e VM), para que ambos tenham a mesma semantica.
+// Os construtores triviais ficam inline por estarem no caminho quente.
+static inline Value value_int(int v) {
+    Value val = { VAL_INT };
+    val.int_val = v;
+    return val;
+}
+
+static inline Value value_bool(int v) {
+    Value val = { VAL_BOOL };
+    val.bool_val = !!v;
+    return val;
+}
+
+static inline Value value_none(void) {
+    Value val = { VAL_NONE };
+    return val;
+}
+
+// Soma, subtracao e produto de inteiros dao a volta modulo 2^32, como no
+// JIT e no C gerado (-fwrapv): feitos em unsigned, sem estouro indefinido.
+// A soma de um reduce da o mesmo resultado em qualquer agrupamento.
+static inline int int_add(int l, int r) {
+    return (int)((unsigned int)l + (unsigned int)r);
+}
+
+static inline int int_sub(int l, int r) {
+    return (int)((unsigned int)l - (unsigned int)r);
+}
+
+static inline int int_mul(int l, int r) {
+    return (int)((unsigned int)l * (unsigned int)r);
+}
+
+// Divisao e resto de inteiros: divisor 0 da 0 e INT_MIN / -1 da INT_MIN
+// (sem o trap da instrucao idiv). O JIT gera codigo com a mesma semantica.
+static inline int int_div(int l, int r) {
+    if (r == 0) return 0;
+    if (r == -1) return (int)(0u - (unsigned int)l);
+    return l / r;
+}
+
+static inline int int_mod(int l, int r) {
+    if (r == 0 || r == -1) return 0;
+    return l % r;
+}
+
+// Embrulha `s` sem copiar; o Value fica com a referencia.
+static inline Value value_str(Str *s) {
+    Value val = { VAL_STRING };
+    val.str = s;
+    return val;
+}
+
+// Copia um valor: strings e tarefas sao compartilhadas, nao duplicadas.
+static inline Value value_copy(Value v) {
+    if (v.type == VAL_STRING) str_retain(v.str);
+    else if (v.type == VAL_TASK) handle_retain(v.task);
+    return v;
+}
+
+static inline void value_free(Value v) {
+    if (v.type == VAL_STRING) str_release(v.str);
+    else if (v.type == VAL_TASK) handle_release(v.task);
+}
+
+Value value_string(const char *s);
+int is_truthy(Value v);
+Value value_coerce(Value v, int type_sym);
+Value value_binop(BinOp op, Value left, Value right);
+Value value_concat(Value *parts, int n);
+void value_append(Value *target, Value part);
+void value_print(Value v);
+void value_print_parts(Value *parts, int n);
+
+// Texto de um valor na concatenacao e no print; ints sao formatados em `tmp`,
+// que precisa de VALUE_TEXT_MAX bytes.
+#define VALUE_TEXT_MAX 12
+const char *value_text(Value v, char *tmp, int *len);
+void value_input(Value *v);
+
+#endif
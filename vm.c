@@ -0,0 +1,276 @@
+#include "vm.h"
+#include "value.h"
+#include "jit.h"
+#include "memo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__)
+#define USE_COMPUTED_GOTO 1
+#endif
+
+typedef struct {
+    const int *ret_pc;
+    int base;
+    int memo;           // funcao com cache: grava o resultado no RETURN; -1 se nao
+} CallFrame;
+
+static _Thread_local Value *stack;
+static _Thread_local int stack_cap;
+static _Thread_local CallFrame *frames;
+static _Thread_local int frame_count, frame_cap;
+
+static void ensure_stack(int needed) {
+    if (needed <= stack_cap) return;
+    while (stack_cap < needed) stack_cap = stack_cap ? stack_cap * 2 : 1024;
+    stack = realloc(stack, sizeof(Value) * stack_cap);
+}
+
+
+void vm_run(Bytecode *bc) {
+    Value *globals = malloc(sizeof(Value) * (bc->globals + 1));
+    for (int i = 0; i < bc->globals; i++) globals[i] = value_none();
+
+    ensure_stack(bc->main.stack);
+    Value *fp = stack;
+    Value *sp = stack;
+    for (int i = 0; i < bc->main.locals; i++) *sp++ = value_none();
+    const int *code = bc->code;
+    const int *pc = code + bc->main.entry;
+
+#ifdef USE_COMPUTED_GOTO
+    static void *labels[] = {
+#define BC_LABEL(name) &&op_##name,
+        BYTECODE_OPS(BC_LABEL)
+#undef BC_LABEL
+    };
+#define DISPATCH() goto *labels[*pc++]
+#define OP(name) op_##name:
+    DISPATCH();
+#else
+#define DISPATCH() continue
+#define OP(name) case BC_##name:
+    for (;;) switch (*pc++) {
+#endif
+
+    OP(PUSH_INT) {
+        *sp++ = value_int(*pc++);
+        DISPATCH();
+    }
+    OP(PUSH_BOOL) {
+        *sp++ = value_bool(*pc++);
+        DISPATCH();
+    }
+    OP(PUSH_STR) {
+        *sp++ = value_str(bc->strings[*pc++]);
+        DISPATCH();
+    }
+    OP(PUSH_NONE) {
+        *sp++ = value_none();
+        DISPATCH();
+    }
+    OP(LOAD_LOCAL) {
+        *sp++ = value_copy(fp[*pc++]);
+        DISPATCH();
+    }
+    OP(STORE_LOCAL) {
+        Value *slot = &fp[*pc++];
+        value_free(*slot);
+        *slot = *--sp;
+        DISPATCH();
+    }
+    OP(DECL_LOCAL) {
+        Value *slot = &fp[pc[0]];
+        value_free(*slot);
+        *slot = value_coerce(*--sp, pc[1]);
+        pc += 2;
+        DISPATCH();
+    }
+    OP(INPUT_LOCAL) {
+        value_input(&fp[*pc++]);
+        DISPATCH();
+    }
+    OP(LOAD_GLOBAL) {
+        *sp++ = value_copy(globals[*pc++]);
+        DISPATCH();
+    }
+    OP(STORE_GLOBAL) {
+        Value *slot = &globals[*pc++];
+        value_free(*slot);
+        *slot = *--sp;
+        DISPATCH();
+    }
+    OP(DECL_GLOBAL) {
+        Value *slot = &globals[pc[0]];
+        value_free(*slot);
+        *slot = value_coerce(*--sp, pc[1]);
+        pc += 2;
+        DISPATCH();
+    }
+    OP(INPUT_GLOBAL) {
+        value_input(&globals[*pc++]);
+        DISPATCH();
+    }
+    OP(APPEND_LOCAL) {
+        value_append(&fp[*pc++], *--sp);
+        DISPATCH();
+    }
+    OP(APPEND_GLOBAL) {
+        value_append(&globals[*pc++], *--sp);
+        DISPATCH();
+    }
+
+    // Operadores: caminho rapido quando os dois lados sao int, senao a
+    // semantica geral de value_binop (concatenacao, bools etc).
+#define INT_BINOP(name, expr, make) \
+    OP(name) { \
+        Value r = *--sp, l = sp[-1]; \
+        if (l.type == VAL_INT && r.type == VAL_INT) { \
+            int a = l.int_val, b = r.int_val; \
+            sp[-1] = make(expr); \
+        } else { \
+            sp[-1] = value_binop(pc[-1] - BC_ADD, l, r); \
+        } \
+        DISPATCH(); \
+    }
+    INT_BINOP(ADD, int_add(a, b), value_int)
+    INT_BINOP(SUB, int_sub(a, b), value_int)
+    INT_BINOP(MUL, int_mul(a, b), value_int)
+    INT_BINOP(DIV, int_div(a, b), value_int)
+    INT_BINOP(MOD, int_mod(a, b), value_int)
+    INT_BINOP(EQ, a == b, value_bool)
+    INT_BINOP(NEQ, a != b, value_bool)
+    INT_BINOP(LT, a < b, value_bool)
+    INT_BINOP(LTE, a <= b, value_bool)
+    INT_BINOP(GT, a > b, value_bool)
+    INT_BINOP(GTE, a >= b, value_bool)
+#undef INT_BINOP
+
+    OP(JUMP) {
+        pc = code + *pc;
+        DISPATCH();
+    }
+    // Fim de volta de um laco contado: i += passo e volta ao topo enquanto
+    // `i <op> limite`. Operandos: slot, passo, BinOp, slot do limite (-1 se
+    // constante), constante, destino.
+    OP(LOOP_INT) {
+        Value *var = &fp[pc[0]];
+        int i = (int)((unsigned int)var->int_val + (unsigned int)pc[1]);
+        *var = value_int(i);
+        int limit = pc[3] < 0 ? pc[4] : fp[pc[3]].int_val;
+        int go;
+        switch (pc[2]) {
+            case OP_LT: go = i < limit; break;
+            case OP_LTE: go = i <= limit; break;
+            case OP_GT: go = i > limit; break;
+            case OP_GTE: go = i >= limit; break;
+            default: go = i != limit; break;
+        }
+        pc = go ? code + pc[5] : pc + 6;
+        DISPATCH();
+    }
+    OP(JUMP_IF_FALSE) {
+        Value cond = *--sp;
+        int truth;
+        if (cond.type == VAL_BOOL || cond.type == VAL_INT) {
+            truth = cond.int_val != 0;
+        } else {
+            truth = is_truthy(cond);
+            value_free(cond);
+        }
+        pc = truth ? pc + 1 : code + *pc;
+        DISPATCH();
+    }
+    OP(CALL) {
+        int index = *pc++;
+        VMFunc *f = &bc->funcs[index];
+        int memo = memo_active(index);
+        if (memo) {
+            Value cached;
+            if (memo_lookup(index, sp - f->params, &cached)) {
+                for (int i = 0; i < f->params; i++) value_free(*--sp);
+                *sp++ = cached;
+                DISPATCH();
+            }
+        }
+        if (jit_enabled && !memo) {
+            JitEntry native = jit_hot(index);
+            if (native) {
+                sp -= f->params;
+                *sp = jit_call(native, index, sp, f->params);
+                sp++;
+                DISPATCH();
+            }
+        }
+        int base = (int)(sp - stack) - f->params;
+        int fp_off = (int)(fp - stack);
+        ensure_stack(base + f->stack);
+        if (frame_count == frame_cap) {
+            frame_cap = frame_cap ? frame_cap * 2 : 64;
+            frames = realloc(frames, sizeof(CallFrame) * frame_cap);
+        }
+        frames[frame_count].ret_pc = pc;
+        frames[frame_count].base = fp_off;
+        frames[frame_count].memo = memo ? index : -1;
+        frame_count++;
+        fp = stack + base;
+        sp = fp + f->params;
+        for (int i = f->params; i < f->locals; i++) *sp++ = value_none();
+        pc = code + f->entry;
+        DISPATCH();
+    }
+    OP(RETURN) {
+        Value result = *--sp;
+        while (sp > fp) value_free(*--sp);
+        *sp++ = result;
+        frame_count--;
+        if (frames[frame_count].memo >= 0) memo_finish(frames[frame_count].memo, result);
+        fp = stack + frames[frame_count].base;
+        pc = frames[frame_count].ret_pc;
+        DISPATCH();
+    }
+    OP(CONCAT) {
+        int n = *pc++;
+        sp -= n;
+        *sp = value_concat(sp, n);
+        sp++;
+        DISPATCH();
+    }
+    OP(PRINT_CONCAT) {
+        int n = *pc++;
+        sp -= n;
+        value_print_parts(sp, n);
+        DISPATCH();
+    }
+    OP(PRINT) {
+        Value v = *--sp;
+        value_print(v);
+        DISPATCH();
+    }
+    OP(POP) {
+        value_free(*--sp);
+        DISPATCH();
+    }
+    OP(HALT) {
+        goto done;
+    }
+
+#ifndef USE_COMPUTED_GOTO
+        default:
+            goto done;
+    }
+#endif
+#undef DISPATCH
+#undef OP
+
+done:
+    while (sp > stack) value_free(*--sp);
+    for (int i = 0; i < bc->globals; i++) value_free(globals[i]);
+    free(globals);
+    free(stack);
+    free(frames);
+    stack = NULL;
+    frames = NULL;
+    stack_cap = frame_count = frame_cap = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef VM_H
+#define VM_H
+#include "parser.h"
+#include "resolve.h"
+
+// Motor alternativo: a AST e compilada para um bytecode compacto (vetor de
+// ints, operandos inline) e executada por um laco de despacho com goto
+// computado. Variaveis sao resolvidas para slots em tempo de compilacao.
+#define BYTECODE_OPS(X) \
+    X(PUSH_INT) X(PUSH_BOOL) X(PUSH_STR) X(PUSH_NONE) \
+    X(LOAD_LOCAL) X(STORE_LOCAL) X(DECL_LOCAL) X(INPUT_LOCAL) \
+    X(LOAD_GLOBAL) X(STORE_GLOBAL) X(DECL_GLOBAL) X(INPUT_GLOBAL) \
+    X(APPEND_LOCAL) X(APPEND_GLOBAL) \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) \
+    X(EQ) X(NEQ) X(LT) X(LTE) X(GT) X(GTE) \
+    X(JUMP) X(JUMP_IF_FALSE) X(LOOP_INT) \
+    X(CALL) X(RETURN) \
+    X(CONCAT) X(PRINT_CONCAT) \
+    X(PRINT) X(POP) X(HALT)
+
+// BC_ADD..BC_GTE seguem a mesma ordem de BinOp.
+typedef enum {
+#define BC_ENUM(name) BC_##name,
+    BYTECODE_OPS(BC_ENUM)
+#undef BC_ENUM
+    BC_COUNT
+} Opcode;
+
+typedef struct {
+    int sym;
+    int entry;      // offset do primeiro opcode
+    int params;
+    int locals;     // slots do frame (parametros incluidos)
+    int stack;      // slots do frame + profundidade maxima da pilha de operandos
+} VMFunc;
+
+typedef struct {
+    int *code;
+    int code_len, code_cap;
+    Str **strings;      // literais (estaticos, pertencem a AST)
+    int string_count, string_cap;
+    VMFunc *funcs;
+    int func_count;
+    int globals;
+    VMFunc main;    // codigo de topo; seus slots locais sao os escopos de `for`
+} Bytecode;
+
+Bytecode *vm_compile(AST *program, Frames frames);
+void vm_run(Bytecode *bc);
+void vm_free(Bytecode *bc);
+
+#endif